@@ -0,0 +1,88 @@
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+
+
+//! Sequential writer for 64 bit aligned binary records, used by the genome cache and the seed index file
+/*! Each record is padded to a multiple of eight bytes, so arrays of 64 bit values can be used in place
+ * when the file is memory mapped */
+class CacheWriter {
+public:
+    //! c'tor
+    /*! \param path File to (over)write */
+    CacheWriter(fs::path const & path) : os_{path, std::ios::binary} {
+        if (!os_.good()) { throw std::runtime_error("[ERROR] -- CacheWriter -- Cannot write to " + path.string()); }
+    }
+    //! Write an array of trivially copyable elements, preceded by its size
+    template <typename T>
+    void array(T const * data, size_t size) { u64(size); bytes(reinterpret_cast<char const *>(data), size * sizeof(T)); }
+    //! Write \c size raw bytes, padded to a multiple of eight
+    void bytes(char const * data, size_t size) {
+        os_.write(data, static_cast<std::streamsize>(size));
+        static char const padding[8] = {};
+        if (size % 8) { os_.write(padding, static_cast<std::streamsize>(8 - (size % 8))); }
+    }
+    //! Write a string, preceded by its size
+    void string(std::string const & s) { u64(s.size()); bytes(s.data(), s.size()); }
+    //! Write a single value
+    void u64(uint64_t value) { os_.write(reinterpret_cast<char const *>(&value), sizeof(value)); }
+    //! Return true if all writes succeeded
+    bool good() const { return os_.good(); }
+    //! Close the file
+    void close() { os_.close(); }
+
+private:
+    //! Output file
+    std::ofstream os_;
+};
+
+
+
+//! Sequential reader for records written by CacheWriter, throws on out of bounds access
+class CacheReader {
+public:
+    //! c'tor
+    /*! \param data Start of the records, e.g. a memory mapped file, must be 8 byte aligned
+     * \param size Number of bytes available at \c data */
+    CacheReader(char const * data, size_t size) : data_{data}, position_{0}, size_{size} {}
+    //! Return a pointer to an array of \c size elements written by CacheWriter::array(), no copy is made
+    template <typename T>
+    T const * array(size_t & size) {
+        size = u64();
+        if (size > size_ / sizeof(T)) { throw std::runtime_error("[ERROR] -- CacheReader -- File is truncated"); }
+        return reinterpret_cast<T const *>(bytes(size * sizeof(T)));
+    }
+    //! Return a pointer to the next \c size bytes and skip them including their padding
+    char const * bytes(size_t size) {
+        auto padded = (size + 7) / 8 * 8;
+        if (padded < size || position_ + padded > size_) { throw std::runtime_error("[ERROR] -- CacheReader -- File is truncated"); }
+        auto ptr = data_ + position_;
+        position_ += padded;
+        return ptr;
+    }
+    //! Offset of the next record
+    size_t position() const { return position_; }
+    //! Read a string
+    std::string string() { auto size = u64(); return std::string(bytes(size), size); }
+    //! Read a single value
+    uint64_t u64() { uint64_t value; std::memcpy(&value, bytes(sizeof(value)), sizeof(value)); return value; }
+
+private:
+    //! Start of the records
+    char const * data_;
+    //! Offset of the next record
+    size_t position_;
+    //! Number of bytes available
+    size_t size_;
+};
+
+#endif // CACHEFILE_H
@@ -3,8 +3,13 @@
 Configuration::Configuration(int argc, char * argv[])
     : allowOverlap_{false},
       allvsall_{false},
+      artificialSequenceSeed_{0},
       artificialSequenceSizeFactor_{1},
       batchsize_{1},
+      buildSeedIndex_{},
+      canonicalSeeds_{false},
+      compressPostings_{0},
+      countSeeds_{false},
       createAllMatches_{false},
       cubeLengthCutoff_{300000000},
       cubeOutput_{0},
@@ -18,6 +23,7 @@ Configuration::Configuration(int argc, char * argv[])
       dynamicArtificialSequences_{false},
       genome1_{},
       genome2_{},
+      genomeCache_{},
       hasse_{false},
       inputFiles_{},
       localSearchArea_{1000},
@@ -26,6 +32,7 @@ Configuration::Configuration(int argc, char * argv[])
       matchLimitDiscardSeeds_{false},
       maxPrefixLength_{15},
       minMatchDistance_{0},
+      minimizerWindow_{1},
       nThreads_{1},
       occurrencePerGenomeMax_{ULLONG_MAX},
       occurrencePerGenomeMin_{1},
@@ -35,6 +42,7 @@ Configuration::Configuration(int argc, char * argv[])
       output_{},
       outputArtificialSequences_{},
       outputRunInformation_{},
+      parallelLinkCreation_{false},
       performDiagonalFiltering_{false},
       performGeometricHashing_{false},
       preAddNeighbouringCubes_{false},
@@ -43,7 +51,13 @@ Configuration::Configuration(int argc, char * argv[])
       preMaskCollection_{nullptr},
       preOptimalSeed_{false},
       postSequential_{false},
+      presenceFilter_{false},
       redmask_{false},
+      referenceSampling_{1},
+      seedIndex_{},
+      seedPartitions_{1},
+      sortedSeedIndex_{false},
+      spillDirectory_{},
       thinning_{1},
       tileSize_{0},
       verbose_{2},
@@ -54,18 +68,25 @@ Configuration::Configuration(int argc, char * argv[])
     po::options_description generalOptions("General Program Options");
     generalOptions.add_options()
             ("allvsall", "Create all Links from all vs. all sequences, if not stated, process one reference sequence at a time (vs. all non-ref sequences)")
+            ("artificial-sequence-seed", po::value<size_t>(), "Seed for the generation of artificial sequences, allows to reproduce a previous run. Chosen randomly if not stated, the seed used is written to the run information.")
             ("artificial-sequence-size-factor", po::value<int>()->default_value(1), "If '--dynamic-artificial-sequences', create artificial sequences of length of this factor times the length of the input sequences")
+            ("canonical-seeds", "Store each seed once under the smaller of its forward and reverse strand form to also find matches on opposite strands. Occurrences on the reverse strand are reported with positions on the reverse complement of their sequence.")
             ("check-parameters-and-exit", "Evaluate the other command line parameters, output any warnings or errors and exit without actually doing something")
+            ("compress-postings", po::value<int>()->default_value(0), "With '--sorted-seed-index', seeds with at least this many occurrences of a mask store them grouped by sequence with delta and varint coded positions instead of 8 bytes per occurrence, e.g. 32. Shrinks the index for repetitive genomes, unique seeds are not affected. 0 (default) never compresses.")
+            ("count-seeds", "Count all seeds in a first pass over the input. The seed map is then reserved for the number of distinct seeds and seeds that fail '--occurrence-per-genome-max' or '--occurrence-per-genome-min' are not stored at all. Reads the input twice, results are the same.")
             ("dynamic-artificial-sequences", "For each real input sequence, add an artificial sequence of the same length to the respective genome.")
             ("batchsize", po::value<int>()->default_value(1), "Divide each input fasta into this number of  batches, run for each possible batch combination (1 for single run, default)")
-            ("input,i", po::value<std::vector<std::string>>()->multitoken(), "List of input files (including first and second genome).")
+            ("build-seed-index", po::value<std::string>(), "Build a seed index of all input genomes, write it to this file and exit. The index can be memory mapped by '--seed-index' and shared by concurrent runs. '--genome2' must not be set, the query genome takes its place. Needs '--allvsall'.")
+            ("input,i", po::value<std::vector<std::string>>()->multitoken(), "List of input files (including first and second genome), may be gzip or bgzip compressed.")
             ("help,h", "Show this message and exit immediately.")
             ("genome1", po::value<std::string>(), "Filename of the first genome. Can be omitted if '--input' and exactly two input genomes.")
             ("genome2", po::value<std::string>(), "Filename of the second genome. Can be omitted if '--input' and exactly two input genomes.")
+            ("genome-cache", po::value<std::string>(), "Binary cache of the preprocessed input genomes. Created if it does not exist or belongs to different input, otherwise loaded instead of parsing the fasta files.")
             ("masks", po::value<std::vector<std::string>>()->multitoken(), "Directly define a set of SpacedSeedMasks of equal weight. Space separated strings can only contain `0` and `1`. Overwrites '--optimal-seed' and explicit '--weight'/'--span'.")
             ("match-limit", po::value<int>()->default_value(10), "Create at most this many (randomly chosen) matches from a seed. Corresponds to link limit in geometric hashing setting. Set to 0 for no limit.")
             ("match-limit-discard-exceeding", "If a seed would give more than '--match-limit' matches, discard all matches rather than sampling")
-            ("max-prefix-length", po::value<int>()->default_value(15), "The internal seed mapping data structure allocates 8*4^(max-prefix-length) bytes of memory plus additional memory for each seed")
+            ("max-prefix-length", po::value<int>()->default_value(15), "With '--sorted-seed-index', seeds are grouped by their first (at most) this many bases in a direct-address table of 8*4^(max-prefix-length) bytes and only the remaining bases are stored. Reduced automatically such that the table has at most one entry per eight seed occurrences")
+            ("minimizer-window", po::value<int>()->default_value(1), "Keep only minimizer seed positions: of each window of this many consecutive seed positions in a sequence, keep the position with the smallest hash of its seed of the first mask (of the canonical seed with '--canonical-seeds'). Shrinks the seed map by roughly (w+1)/2, each window keeps at least one position in every genome. Cannot be combined with '--reference-sampling'. 1 (default) keeps all positions.")
             ("occurrence-per-genome-max", po::value<int>()->default_value(0), "At most this many seed occurrences in any genome. Set to 0 for no threshold. Does not work as expected with --batchsize > 1.")
             ("occurrence-per-genome-min", po::value<int>()->default_value(1), "At least this many seed occurrences in a genome (if any occurrences in the respective genome). Does not work as expected with --batchsize > 1.")
             ("occurrence-per-sequence-max", po::value<int>()->default_value(0), "At most this many seed occurrences in a sequence, otherwise the respective sequence is not considered in seed creation. Set to 0 for no threshold. Does not work as expected with --fast.")
@@ -74,6 +95,7 @@ Configuration::Configuration(int argc, char * argv[])
             ("output-artificial-sequences", po::value<std::string>(), "Write generated artificial sequences to this file. Does not write if not stated.")
             ("output-run-information", po::value<std::string>(), "Write JSON representation of configuration and run statistics. Does not write if not stated.")
             ("p,p", po::value<int>(), "Number of threads to create when code is executed in parallel (positive integer, default: number of CPU cores available).")
+            ("parallel-link-creation", "Create the links of all-vs-all and '--seed-index' runs in parallel, each thread processes a part of the seed map into its own link set, which are merged afterwards. Can be faster on many threads, but the link sets of all threads are held in memory at once. Results are the same.")
             ("pre-add-neighbouring-cubes", "For pre-filter steop (GH or M1-3). Add all neighbours to found relevant cubes")
             ("pre-link-threshold", po::value<int>()->default_value(5), "For pre-filter step (GH or M1-3). A cube needs at least this many links to pass the pre-filter and be considered in second GH run")
             ("pre-masks", po::value<std::vector<std::string>>()->multitoken(), "For pre-filter step (GH or M1-3). Directly define a set of SpacedSeedMasks of equal weight. Space separated strings can only contain `0` and `1`. Overwrites '--pre-optimal-seed' and explicit '--pre-weight'/'--pre-span'.")
@@ -82,8 +104,14 @@ Configuration::Configuration(int argc, char * argv[])
             ("pre-span", po::value<int>(), "For pre-filter step (GH or M1-3). Spaced seed length >= weight. Default: same as '--pre-weight', i.e. contiguous seeds. Overwrites '--pre-weight-fraction' if stated.")
             ("pre-weight", po::value<int>(), "For pre-filter step (GH or M1-3). Weight of spaced seed (positive integer).")
             ("pre-weight-fraction", po::value<double>()->default_value(1.), "For pre-filter step (GH or M1-3). Fraction of 'care'-positions in a seed, i.e. pre-span = ceil(pre-weight/pre-weight-fraction). No effect if '--pre-span' is given explicitly.")
+            ("presence-filter", "Run a first pass over the input that records in Bloom filters which seeds occur in the reference genome and which in any other genome. Only seeds found in both are stored in the seed map, all others could not create matches anyway. Reads the input twice, results are the same.")
             ("redmask", "Apply YASS-like redmask filter, i.e. discard low complexity seeds consisting of only one or two nucleotides.")
+            ("reference-sampling", po::value<int>()->default_value(1), "Extract seeds of the reference genome ('--genome1') only at positions that are a multiple of this number, all other genomes are seeded at every position. A shared region of at least span+s-1 bp still has a reference seed, but the seed map, the reference seed map and the number of redundant links shrink by about this factor. Cannot be combined with '--minimizer-window'. 1 (default) seeds the reference at every position.")
+            ("seed-index", po::value<std::string>(), "Seed index written by '--build-seed-index'. Only the query genomes in '--input' are read, their seeds are matched against the memory mapped index. '--genome1' must be the reference genome of the index, '--genome2' is the query genome (can be omitted for a single input). Masks and the seed options '--canonical-seeds', '--minimizer-window', '--redmask', '--reference-sampling' and '--thinning' must be the same as for the index. Needs '--allvsall'.")
+            ("seed-partitions", po::value<int>()->default_value(1), "Out-of-core mode: spill all seed occurrences to this many files in '--spill-directory', partitioned by seed hash, then build the seed map and create links for one partition at a time. Peak memory of the seed map is that of the largest partition, results are the same. Needs '--allvsall' and one open file per partition, i.e. is limited by the open file limit (ulimit -n). 1 (default) keeps all seeds in memory.")
             ("seed-set-size", po::value<int>()->default_value(1), "Number of spaced seeds (if any) to generate. No effect if span equals weight (default).")
+            ("sorted-seed-index", "Build the seed map by sorting all seed occurrences into a compact index (unique seeds, offsets, packed occurrences) instead of a hash map of occurrence vectors. Needs considerably less memory, results are the same.")
+            ("spill-directory", po::value<std::string>(), "Directory for the partition files of '--seed-partitions'. Default: the system's temporary directory.")
             ("span", po::value<int>(), "spaced seed length >= weight. Default: same as '--weight', i.e. contiguous seeds. Overwrites '--weight-fraction' if stated.")
             ("thinning", po::value<int>()->default_value(1), "Discard roughly 1/thinning of input k-mers to save memory, set to 1 for not thinning (default)")
             ("verbose", po::value<int>()->default_value(2), "Set verbosity level of terminal output: 0 - no output, 1 - static output messages (use to pipe program output into logfile), 2 - static messages and progress bars (default)")
@@ -159,9 +187,7 @@ void Configuration::validateOptions(po::variables_map & vm) {
     // lambda to strip extension from a path string
     auto stripExtension = [&vm](std::string const & pathstr, bool graphInput = false) {
         if (graphInput) { return pathstr; } // metagraph stores complete paths as genome names
-        auto path = fs::path(pathstr);
-        path.replace_extension("");
-        return (path.filename()).string();
+        return FastaRepresentation::genomeFromFilename(pathstr);
     };
     // lambda to deal with mask stuff
     auto setMasks = [this,
@@ -220,6 +246,14 @@ void Configuration::validateOptions(po::variables_map & vm) {
     // general options
     // --allvsall
     allvsall_ = userSet("allvsall");
+    // --artificial-sequence-seed
+    if (userSet("artificial-sequence-seed")) {
+        warnUselessIfNotSet("artificial-sequence-seed", "dynamic-artificial-sequences");
+        artificialSequenceSeed_ = vm["artificial-sequence-seed"].as<size_t>();
+    } else {
+        std::random_device rd;
+        artificialSequenceSeed_ = (static_cast<size_t>(rd()) << 32) ^ rd();
+    }
     // --artificial-sequence-size-factor
     if (userSet("artificial-sequence-size-factor")) { warnUselessIfNotSet("artificial-sequence-size-factor", "dynamic-artificial-sequences"); }
     artificialSequenceSizeFactor_ = castWithBoundaryCheck<int, size_t>(vm, "artificial-sequence-size-factor", 1, INT_MAX);
@@ -227,28 +261,79 @@ void Configuration::validateOptions(po::variables_map & vm) {
     dynamicArtificialSequences_ = userSet("dynamic-artificial-sequences");
     // batchsize
     batchsize_ = castWithBoundaryCheck<int, size_t>(vm, "batchsize", 1, INT_MAX);
+    // --build-seed-index
+    if (userSet("build-seed-index")) {
+        buildSeedIndex_ = fs::path(vm["build-seed-index"].as<std::string>());
+        if (fs::exists(buildSeedIndex_) && !fs::is_regular_file(buildSeedIndex_)) {
+            throw std::runtime_error("[ERROR] -- Seed index '" + buildSeedIndex_.string() + "' is not a regular file");
+        }
+    }
+    // --canonical-seeds
+    canonicalSeeds_ = userSet("canonical-seeds");
+    // --count-seeds
+    countSeeds_ = userSet("count-seeds");
+    // --seed-index
+    if (userSet("seed-index")) {
+        if (userSet("build-seed-index")) { throw std::runtime_error("[ERROR] -- '--seed-index' and '--build-seed-index' cannot be combined"); }
+        seedIndex_ = fs::path(vm["seed-index"].as<std::string>());
+        if (!fs::is_regular_file(seedIndex_)) {
+            throw std::runtime_error("[ERROR] -- Seed index '" + seedIndex_.string() + "' is not a regular file");
+        }
+    }
+    auto seedIndexMode = !(buildSeedIndex_.empty() && seedIndex_.empty());
+    if (seedIndexMode) {
+        if (!allvsall_) { throw std::runtime_error("[ERROR] -- '--build-seed-index' and '--seed-index' need '--allvsall'"); }
+        if (batchsize_ > 1) { throw std::runtime_error("[ERROR] -- '--build-seed-index' and '--seed-index' cannot run in batch mode"); }
+        if (userSet("presence-filter")) { throw std::runtime_error("[ERROR] -- '--presence-filter' needs all genomes in the input and cannot be combined with a seed index"); }
+        if (userSet("pre-masks") || userSet("pre-weight")) { throw std::runtime_error("[ERROR] -- The pre-filter step cannot be combined with a seed index"); }
+        if (userSet("seed-index") && userSet("genome-cache")) { throw std::runtime_error("[ERROR] -- '--genome-cache' cannot be combined with '--seed-index'"); }
+    }
     // --input
     throwMandatory("input");
     inputFiles_ = vm["input"].as<std::vector<std::string>>();
     auto numberOfInputGenomes = inputFiles_.size();
-    if (numberOfInputGenomes < 2) { throw std::runtime_error("[ERROR] -- '--input' needs at least two genomes"); }
+    if (numberOfInputGenomes < 1 || (!seedIndexMode && numberOfInputGenomes < 2)) { throw std::runtime_error("[ERROR] -- '--input' needs at least two genomes"); }
     // --genome1/2
-    if (numberOfInputGenomes > 2) {
+    if (!buildSeedIndex_.empty()) {     // the query genome of the index gets ID 1 later, no genome of the index may take it
+        if (userSet("genome2")) { throw std::runtime_error("[ERROR] -- '--genome2' cannot be set with '--build-seed-index'"); }
+        if (numberOfInputGenomes > 1) { throwMandatory("genome1"); }
+        genome1_ = stripExtension(userSet("genome1") ? vm["genome1"].as<std::string>() : inputFiles_.at(0));
+        genome2_ = "";
+    } else if (!seedIndex_.empty()) {   // '--genome1' is in the index, not in the input
         throwMandatory("genome1");
-        throwMandatory("genome2");
-    }
-    // if --input, possible that no genome1/2; if --graph, genome1/2 mandatory so else never executed
-    if (userSet("genome1")) {
-        throwMandatory("genome2");
+        if (numberOfInputGenomes > 1) { throwMandatory("genome2"); }
         genome1_ = stripExtension(vm["genome1"].as<std::string>());
+        genome2_ = stripExtension(userSet("genome2") ? vm["genome2"].as<std::string>() : inputFiles_.at(0));
+        for (auto&& input : inputFiles_) {    // the reference would be seeded again and joined with its own occurrences
+            if (stripExtension(input) == genome1_) {
+                throw std::runtime_error("[ERROR] -- '--genome1' " + genome1_ + " is in the seed index and must not be part of '--input'");
+            }
+        }
     } else {
-        genome1_ = stripExtension(inputFiles_.at(0));
+        if (numberOfInputGenomes > 2) {
+            throwMandatory("genome1");
+            throwMandatory("genome2");
+        }
+        // if --input, possible that no genome1/2; if --graph, genome1/2 mandatory so else never executed
+        if (userSet("genome1")) {
+            throwMandatory("genome2");
+            genome1_ = stripExtension(vm["genome1"].as<std::string>());
+        } else {
+            genome1_ = stripExtension(inputFiles_.at(0));
+        }
+        if (userSet("genome2")) {
+            throwMandatory("genome1");
+            genome2_ = stripExtension(vm["genome2"].as<std::string>());
+        } else {
+            genome2_ = stripExtension(inputFiles_.at(1));
+        }
     }
-    if (userSet("genome2")) {
-        throwMandatory("genome1");
-        genome2_ = stripExtension(vm["genome2"].as<std::string>());
-    } else {
-        genome2_ = stripExtension(inputFiles_.at(1));
+    // --genome-cache
+    if (userSet("genome-cache")) {
+        genomeCache_ = fs::path(vm["genome-cache"].as<std::string>());
+        if (fs::exists(genomeCache_) && !fs::is_regular_file(genomeCache_)) {
+            throw std::runtime_error("[ERROR] -- Genome cache '" + genomeCache_.string() + "' is not a regular file");
+        }
     }
     // --match-limit
     matchLimit_ = castWithBoundaryCheck<int, size_t>(vm, "match-limit", 0, INT_MAX);
@@ -258,6 +343,8 @@ void Configuration::validateOptions(po::variables_map & vm) {
     matchLimitDiscardSeeds_ = userSet("match-limit-discard-exceeding");
     // --max-prefix-length
     maxPrefixLength_ = castWithBoundaryCheck<int, size_t>(vm, "max-prefix-length", 1, INT_MAX);
+    // --minimizer-window
+    minimizerWindow_ = castWithBoundaryCheck<int, size_t>(vm, "minimizer-window", 1, INT_MAX);
     // --occurrence-per-genome-max
     occurrencePerGenomeMax_ = castWithBoundaryCheck<int, size_t>(vm, "occurrence-per-genome-max", 0, INT_MAX);
     occurrencePerGenomeMax_ = (occurrencePerGenomeMax_ == 0) ? ULLONG_MAX : occurrencePerGenomeMax_;
@@ -308,6 +395,8 @@ void Configuration::validateOptions(po::variables_map & vm) {
         std::cerr << "[WARNING] -- Could not determine number of threads automatically, using only one thread" << std::endl;
         nThreads_ = 1;
     }
+    // --parallel-link-creation
+    parallelLinkCreation_ = userSet("parallel-link-creation");
     // --pre-add-neghbouring-cubes
     preAddNeighbouringCubes_ = userSet("pre-add-neighbouring-cubes");
     // --pre-link-threshold
@@ -322,8 +411,36 @@ void Configuration::validateOptions(po::variables_map & vm) {
                  "pre-seed-set-size",
                  preOptimalSeed_, preMaskCollection_);
     }
+    // --presence-filter
+    presenceFilter_ = userSet("presence-filter");
     // --redmask
     redmask_ = userSet("redmask");
+    // --reference-sampling
+    referenceSampling_ = castWithBoundaryCheck<int, size_t>(vm, "reference-sampling", 1, INT_MAX);
+    if (referenceSampling_ > 1 && minimizerWindow_ > 1) {   // sampled minimizers can leave long reference stretches without a seed
+        throw std::runtime_error("[ERROR] -- '--reference-sampling' and '--minimizer-window' cannot be combined");
+    }
+    // --sorted-seed-index
+    sortedSeedIndex_ = userSet("sorted-seed-index") || !buildSeedIndex_.empty();   // a persisted index is always sorted
+    // --compress-postings
+    compressPostings_ = castWithBoundaryCheck<int, size_t>(vm, "compress-postings", 0, INT_MAX);
+    if (compressPostings_ > 0 && !sortedSeedIndex_) {
+        throw std::runtime_error("[ERROR] -- '--compress-postings' needs '--sorted-seed-index' or '--build-seed-index'");
+    }
+    // --seed-partitions
+    seedPartitions_ = castWithBoundaryCheck<int, size_t>(vm, "seed-partitions", 1, 65536);
+    if (seedPartitions_ > 1) {
+        if (!allvsall_) { throw std::runtime_error("[ERROR] -- '--seed-partitions' needs '--allvsall'"); }
+        if (batchsize_ > 1) { throw std::runtime_error("[ERROR] -- '--seed-partitions' cannot run in batch mode"); }
+        if (preMaskCollection_) { throw std::runtime_error("[ERROR] -- The pre-filter step cannot be combined with '--seed-partitions'"); }
+        if (!buildSeedIndex_.empty()) { throw std::runtime_error("[ERROR] -- '--build-seed-index' cannot be combined with '--seed-partitions'"); }
+    }
+    // --spill-directory
+    warnUselessIfNotSet("spill-directory", "seed-partitions");
+    spillDirectory_ = userSet("spill-directory") ? fs::path(vm["spill-directory"].as<std::string>()) : fs::temp_directory_path();
+    if (seedPartitions_ > 1 && !fs::is_directory(spillDirectory_)) {
+        throw std::runtime_error("[ERROR] -- Spill directory '" + spillDirectory_.string() + "' is not a directory");
+    }
     // masks
     setMasks("masks",
              "optimal-seed",
@@ -352,8 +469,10 @@ void Configuration::validateOptions(po::variables_map & vm) {
     warnUselessIfNotSet("yass-mutation", "yass");
     yassMutation_ = castWithBoundaryCheck<double, double>(vm, "yass-mutation", 0, 1);
 
-    diagonalRho_ = computeRho(yassMutation_, maskCollection_->weight(), yassEpsilon_);
-    diagonalDelta_ = computeDelta(yassIndel_, diagonalRho_, yassEpsilon_);
+    if (performDiagonalFiltering_) {   // computeRho() takes very long for large weights, only needed for the filter
+        diagonalRho_ = computeRho(yassMutation_, maskCollection_->weight(), yassEpsilon_);
+        diagonalDelta_ = computeDelta(yassIndel_, diagonalRho_, yassEpsilon_);
+    }
 
     // --diagonal-threshold
     warnUselessIfNotSet("diagonal-threshold", "diagonal-filtering");
@@ -420,8 +539,13 @@ JsonValue Configuration::configJson() const {
     JsonStreamDict map(jsonstream);
     map.addValue("allowOverlap", allowOverlap_);
     map.addValue("allvsall", allvsall_);
+    map.addValue("artificialSequenceSeed", artificialSequenceSeed_);
     map.addValue("artificialSequenceSizeFactor", artificialSequenceSizeFactor_);
     map.addValue("batchsize", batchsize_);
+    map.addValue("buildSeedIndex", buildSeedIndex_.string());
+    map.addValue("canonicalSeeds", canonicalSeeds_);
+    map.addValue("compressPostings", compressPostings_);
+    map.addValue("countSeeds", countSeeds_);
     map.addValue("createAllMatches", createAllMatches_);
     map.addValue("cubeLengthCutoff", cubeLengthCutoff_);
     map.addValue("cubeOutput", cubeOutput_);
@@ -429,12 +553,15 @@ JsonValue Configuration::configJson() const {
     map.addValue("cubeScoreParameter", cubeScoreParameter_);
     map.addValue("cubeScoreParameterChunks", cubeScoreParameterChunks_);
     map.addValue("cubeScoreThreshold", cubeScoreThreshold_);
-    map.addValue("diagonalDelta", diagonalDelta_);
-    map.addValue("diagonalRho", diagonalRho_);
+    if (performDiagonalFiltering_) {   // not computed otherwise
+        map.addValue("diagonalDelta", diagonalDelta_);
+        map.addValue("diagonalRho", diagonalRho_);
+    }
     map.addValue("diagonalThreshold", diagonalThreshold_);
     map.addValue("dynamicArtificialSequences", dynamicArtificialSequences_);
     map.addValue("genome1", genome1_);
     map.addValue("genome2", genome2_);
+    map.addValue("genomeCache", genomeCache_.string());
     map.addValue("hasse", hasse_);
     map.addValue("inputFiles", inputFiles_);
     map.addValue("localSearchArea", localSearchArea_);
@@ -443,12 +570,14 @@ JsonValue Configuration::configJson() const {
     map.addValue("matchLimitDiscardExceeding", matchLimitDiscardSeeds_);
     map.addValue("maxPrefixLength", maxPrefixLength_);
     map.addValue("minMatchDistance", minMatchDistance_);
+    map.addValue("minimizerWindow", minimizerWindow_);
     map.addValue("nThreads", nThreads_);
     map.addValue("occurrencePerGenomeMax", occurrencePerGenomeMax_);
     map.addValue("occurrencePerGenomeMin", occurrencePerGenomeMin_);
     map.addValue("occurrencePerSequenceMax", occurrencePerSequenceMax_);
     map.addValue("oldCubeScore", oldCubeScore_);
     map.addValue("optimalSeed", optimalSeed_);
+    map.addValue("parallelLinkCreation", parallelLinkCreation_);
     map.addValue("performDiagonalFiltering", performDiagonalFiltering_);
     map.addValue("performGeometricHashing", performGeometricHashing_);
     map.addValue("preAddNeighbouringCubes", preAddNeighbouringCubes_);
@@ -470,8 +599,14 @@ JsonValue Configuration::configJson() const {
         map.addValue("pre-weight", 0);
     }
     map.addValue("post-sequential", postSequential_);
+    map.addValue("presenceFilter", presenceFilter_);
     map.addValue("redmask", redmask_);
+    map.addValue("referenceSampling", referenceSampling_);
+    map.addValue("seedIndex", seedIndex_.string());
+    map.addValue("seedPartitions", seedPartitions_);
     map.addValue("seedSetSize", seedSetSize());
+    map.addValue("sortedSeedIndex", sortedSeedIndex_);
+    map.addValue("spillDirectory", spillDirectory_.string());
     map.addValue("span", span());
     map.addValue("thinning", thinning_);
     map.addValue("tileSize", tileSize_);
@@ -491,8 +626,13 @@ std::ostream & operator<<(std::ostream & os, Configuration const & conf) {
     os << "Configuration:" << std::endl;
     os << "\t" << "--allow-overlap " << conf.allowOverlap_ << std::endl;
     os << "\t" << "--allvsall " << conf.allvsall_ << std::endl;
+    os << "\t" << "--artificial-sequence-seed " << conf.artificialSequenceSeed_ << std::endl;
     os << "\t" << "--artificial-sequence-size-factor " << conf.artificialSequenceSizeFactor_ << std::endl;
     os << "\t" << "--batchsize " << conf.batchsize_ << std::endl;
+    os << "\t" << "--build-seed-index " << conf.buildSeedIndex_.string() << std::endl;
+    os << "\t" << "--canonical-seeds " << conf.canonicalSeeds_ << std::endl;
+    os << "\t" << "--compress-postings " << conf.compressPostings_ << std::endl;
+    os << "\t" << "--count-seeds " << conf.countSeeds_ << std::endl;
     os << "\t" << "createAllMatches_ " << conf.createAllMatches_ << std::endl;
     os << "\t" << "--cube-length-cutoff " << conf.cubeLengthCutoff_ << std::endl;
     os << "\t" << "--cube-output " << conf.cubeOutput_ << std::endl;
@@ -500,13 +640,16 @@ std::ostream & operator<<(std::ostream & os, Configuration const & conf) {
     os << "\t" << "--cube-score-parameter-chunks " << conf.cubeScoreParameterChunks_ << std::endl;
     os << "\t" << "--cube-score-normalization-parameter " << conf.cubeScoreNormalizationParameter_ << std::endl;
     os << "\t" << "--cube-score-threshold " << conf.cubeScoreThreshold_ << std::endl;
-    os << "\t" << "diagonalDelta " << conf.diagonalDelta_ << std::endl;
-    os << "\t" << "diagonalRho " << conf.diagonalRho_ << std::endl;
+    if (conf.performDiagonalFiltering_) {
+        os << "\t" << "diagonalDelta " << conf.diagonalDelta_ << std::endl;
+        os << "\t" << "diagonalRho " << conf.diagonalRho_ << std::endl;
+    }
     os << "\t" << "--diagonal-threshold " << conf.diagonalThreshold_ << std::endl;
     os << "\t" << "--dynamic-artificial-sequences " << conf.dynamicArtificialSequences_ << std::endl;
     os << "\t" << "--input " << conf.inputFiles_ << std::endl;
     os << "\t" << "--genome1 " << conf.genome1_ << std::endl;
     os << "\t" << "--genome2 " << conf.genome2_ << std::endl;
+    os << "\t" << "--genome-cache " << conf.genomeCache_.string() << std::endl;
     os << "\t" << "--hasse " << conf.hasse_ << std::endl;
     os << "\t" << "--local-search-area " << conf.localSearchArea_ << std::endl;
     os << "\t" << "--masks " << conf.masks() << std::endl;
@@ -514,6 +657,7 @@ std::ostream & operator<<(std::ostream & os, Configuration const & conf) {
     os << "\t" << "--match-limit-discard-exceeding " << conf.matchLimitDiscardSeeds_ << std::endl;
     os << "\t" << "--max-prefix-length " << conf.maxPrefixLength_ << std::endl;
     os << "\t" << "--min-match-distance " << conf.minMatchDistance_ << std::endl;
+    os << "\t" << "--minimizer-window " << conf.minimizerWindow_ << std::endl;
     os << "\t" << "--occurrence-per-genome-max " << conf.occurrencePerGenomeMax_ << std::endl;
     os << "\t" << "--occurrence-per-genome-min " << conf.occurrencePerGenomeMin_ << std::endl;
     os << "\t" << "--occurrence-per-sequence-max " << conf.occurrencePerSequenceMax_ << std::endl;
@@ -522,6 +666,7 @@ std::ostream & operator<<(std::ostream & os, Configuration const & conf) {
     os << "\t" << "--output " << conf.output_ << std::endl;
     os << "\t" << "--output-artificial-sequences " << conf.outputArtificialSequences_ << std::endl;
     os << "\t" << "--p " << conf.nThreads_ << std::endl;
+    os << "\t" << "--parallel-link-creation " << conf.parallelLinkCreation_ << std::endl;
     os << "\t" << "perform diagonal filtering " << conf.performDiagonalFiltering_ << std::endl;
     os << "\t" << "perform geometric-hashing " << conf.performGeometricHashing_ << std::endl;
     os << "\t" << "--pre-add-neighbouring-cubes " << conf.preAddNeighbouringCubes_ << std::endl;
@@ -537,8 +682,14 @@ std::ostream & operator<<(std::ostream & os, Configuration const & conf) {
     os << "\t" << "--pre-weight ";
     if (conf.preMaskCollection()) { os << conf.preMaskCollection()->weight() << std::endl; } else { os << "" << std::endl; }
     os << "\t" << "--post-sequential " << conf.postSequential_ << std::endl;
+    os << "\t" << "--presence-filter " << conf.presenceFilter_ << std::endl;
     os << "\t" << "--redmask " << conf.redmask_ << std::endl;
+    os << "\t" << "--reference-sampling " << conf.referenceSampling_ << std::endl;
+    os << "\t" << "--seed-index " << conf.seedIndex_.string() << std::endl;
+    os << "\t" << "--seed-partitions " << conf.seedPartitions_ << std::endl;
     os << "\t" << "--seed-set-size " << conf.seedSetSize() << std::endl;
+    os << "\t" << "--sorted-seed-index " << conf.sortedSeedIndex_ << std::endl;
+    os << "\t" << "--spill-directory " << conf.spillDirectory_.string() << std::endl;
     os << "\t" << "--span " << conf.span() << std::endl;
     os << "\t" << "--thinning " << conf.thinning_ << std::endl;
     os << "\t" << "--tilesize " << conf.tileSize_ << std::endl;
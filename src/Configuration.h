@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
@@ -29,8 +30,13 @@ using namespace mabl3;
 // https://www.fluentcpp.com/2016/12/08/strong-types-for-strong-interfaces/
 using AllowOverlap = NamedType<bool, struct AllowOverlapTag>;
 using Allvsall = NamedType<bool, struct AllvsallTag>;
+using ArtificialSequenceSeed = NamedType<size_t, struct ArtificialSequenceSeedTag>;
 using ArtificialSequenceSizeFactor = NamedType<size_t, struct ArtificialSequenceSizeFactorTag>;
 using Batchsize = NamedType<size_t, struct BatchsizeTag>;
+using BuildSeedIndexPath = NamedType<fs::path, struct BuildSeedIndexPathTag>;
+using CanonicalSeeds = NamedType<bool, struct CanonicalSeedsTag>;
+using CompressPostings = NamedType<size_t, struct CompressPostingsTag>;
+using CountSeeds = NamedType<bool, struct CountSeedsTag>;
 using CreateAllMatches = NamedType<bool, struct CreateAllMatchesTag>;
 using CubeLengthCutoff = NamedType<size_t, struct CubeLengthCutoffTag>;
 using CubeOutput = NamedType<size_t, struct CubeOutputTag>;
@@ -45,6 +51,7 @@ using DynamicArtificialSequences = NamedType<bool, struct DynamicArtificialSeque
 using InputFiles = NamedType<std::vector<std::string>, struct InputFilesTag>;
 using Genome1 = NamedType<std::string, struct Genome1Tag>;
 using Genome2 = NamedType<std::string, struct Genome2Tag>;
+using GenomeCachePath = NamedType<fs::path, struct GenomeCachePathTag>;
 using Hasse = NamedType<bool, struct HasseTag>;
 using LocalSearchAreaLength = NamedType<size_t, struct LocalSearchAreaLengthTag>;
 using MaskCollectionPtr = NamedType<std::shared_ptr<SpacedSeedMaskCollection const>, struct MaskCollectionPtrTag>;
@@ -52,6 +59,7 @@ using MatchLimit = NamedType<size_t, struct MatchLimitTag>;
 using MatchLimitDiscardSeeds = NamedType<bool, struct MatchLimitDiscardSeedsTag>;
 using MaxPrefixLength = NamedType<size_t, struct MaxPrefixLengthTag>;
 using MinMatchDistance = NamedType<size_t, struct MinMatchDistanceTag>;
+using MinimizerWindow = NamedType<size_t, struct MinimizerWindowTag>;
 using NThreads = NamedType<size_t, struct NThreadsTag>;
 using OccurrencePerGenomeMax = NamedType<size_t, struct OccurrencePerGenomeMaxTag>;
 using OccurrencePerGenomeMin = NamedType<size_t, struct OccurrencePerGenomeMinTag>;
@@ -61,6 +69,7 @@ using OptimalSeed = NamedType<bool, struct OptimalSeedTag>;
 using OutputPath = NamedType<fs::path, struct OutputTag>;
 using OutputArtificialSequences = NamedType<fs::path, struct OutputArtificialSequencesTag>;
 using OutputRunInformation = NamedType<fs::path, struct OutputRunInformationTag>;
+using ParallelLinkCreation = NamedType<bool, struct ParallelLinkCreationTag>;
 using PerformDiagonalFiltering = NamedType<bool, struct PerformDiagonalFilteringTag>;
 using PerformGeometricHashing = NamedType<bool, struct PerformGeometricHashingTag>;
 using PreAddNeighbouringCubes = NamedType<bool, struct PreAddNeighbouringCubesTag>;
@@ -69,7 +78,13 @@ using PostSequential = NamedType<bool, struct PostSeqentialTag>;
 using PreLinkThreshold = NamedType<size_t, struct PreLinkThresholdTag>;
 using PreMaskCollectionPtr = NamedType<std::shared_ptr<SpacedSeedMaskCollection const>, struct PreMaskCollectionPtrTag>;
 using PreOptimalSeed = NamedType<bool, struct PreOptimalSeedTag>;
+using PresenceFilter = NamedType<bool, struct PresenceFilterTag>;
 using Redmask = NamedType<bool, struct RedmaksTag>;
+using ReferenceSampling = NamedType<size_t, struct ReferenceSamplingTag>;
+using SeedIndexPath = NamedType<fs::path, struct SeedIndexPathTag>;
+using SeedPartitions = NamedType<size_t, struct SeedPartitionsTag>;
+using SortedSeedIndex = NamedType<bool, struct SortedSeedIndexTag>;
+using SpillDirectory = NamedType<fs::path, struct SpillDirectoryTag>;
 using Thinning = NamedType<size_t, struct ThinningTag>;
 using TileSize = NamedType<size_t, struct TileSizeTag>;
 using Verbose = NamedType<size_t, struct VerboseTag>;
@@ -96,8 +111,13 @@ public:
     /*! \details Explicitly define each member directly */
     Configuration(AllowOverlap allowOverlap,
                   Allvsall allvsall,
+                  ArtificialSequenceSeed artificialSequenceSeed,
                   ArtificialSequenceSizeFactor artificialSequenceSizeFactor,
                   Batchsize batchsize,
+                  BuildSeedIndexPath buildSeedIndex,
+                  CanonicalSeeds canonicalSeeds,
+                  CompressPostings compressPostings,
+                  CountSeeds countSeeds,
                   CreateAllMatches createAllMatches,
                   CubeLengthCutoff cubeLengthCutoff,
                   CubeOutput cubeOutput,
@@ -111,6 +131,7 @@ public:
                   DynamicArtificialSequences dynamicArtificialSequences,
                   Genome1 genome1,
                   Genome2 genome2,
+                  GenomeCachePath genomeCache,
                   Hasse hasse,
                   InputFiles inputFiles,
                   LocalSearchAreaLength localSearchAreaLength,
@@ -119,6 +140,7 @@ public:
                   MatchLimitDiscardSeeds matchLimitDiscardSeeds,
                   MaxPrefixLength maxPrefixLength,
                   MinMatchDistance minMatchDistance,
+                  MinimizerWindow minimizerWindow,
                   NThreads nThreads,
                   OccurrencePerGenomeMax occurrencePerGenomeMax,
                   OccurrencePerGenomeMin occurrencePerGenomeMin,
@@ -128,6 +150,7 @@ public:
                   OutputPath output,
                   OutputArtificialSequences outputArtificialSequences,
                   OutputRunInformation outputRunInformation,
+                  ParallelLinkCreation parallelLinkCreation,
                   PerformDiagonalFiltering performDiagonalFiltering,
                   PerformGeometricHashing performGeometricHashing,
                   PreAddNeighbouringCubes preAddNeighbouringCubes,
@@ -136,7 +159,13 @@ public:
                   PreMaskCollectionPtr preMaskCollection,
                   PreOptimalSeed preOptimalSeed,
                   PostSequential postSequential,
+                  PresenceFilter presenceFilter,
                   Redmask redmask,
+                  ReferenceSampling referenceSampling,
+                  SeedIndexPath seedIndex,
+                  SeedPartitions seedPartitions,
+                  SortedSeedIndex sortedSeedIndex,
+                  SpillDirectory spillDirectory,
                   Thinning thinning,
                   TileSize tileSize,
                   Verbose verbose,
@@ -146,8 +175,13 @@ public:
                   YassMutation yassMutation)
         : allowOverlap_{allowOverlap.get()},
           allvsall_{allvsall.get()},
+          artificialSequenceSeed_{artificialSequenceSeed.get()},
           artificialSequenceSizeFactor_{artificialSequenceSizeFactor.get()},
           batchsize_{batchsize.get()},
+          buildSeedIndex_{buildSeedIndex.get()},
+          canonicalSeeds_{canonicalSeeds.get()},
+          compressPostings_{compressPostings.get()},
+          countSeeds_{countSeeds.get()},
           createAllMatches_{createAllMatches.get()},
           cubeLengthCutoff_{cubeLengthCutoff.get()},
           cubeOutput_{cubeOutput.get()},
@@ -161,6 +195,7 @@ public:
           dynamicArtificialSequences_{dynamicArtificialSequences.get()},
           genome1_{genome1.get()},
           genome2_{genome2.get()},
+          genomeCache_{genomeCache.get()},
           hasse_{hasse.get()},
           inputFiles_{inputFiles.get()},
           localSearchArea_{localSearchAreaLength.get()},
@@ -169,6 +204,7 @@ public:
           matchLimitDiscardSeeds_{matchLimitDiscardSeeds.get()},
           maxPrefixLength_{maxPrefixLength.get()},
           minMatchDistance_{minMatchDistance.get()},
+          minimizerWindow_{minimizerWindow.get()},
           nThreads_{nThreads.get()},
           occurrencePerGenomeMax_{occurrencePerGenomeMax.get()},
           occurrencePerGenomeMin_{occurrencePerGenomeMin.get()},
@@ -178,6 +214,7 @@ public:
           output_{output.get()},
           outputArtificialSequences_{outputArtificialSequences.get()},
           outputRunInformation_{outputRunInformation.get()},
+          parallelLinkCreation_{parallelLinkCreation.get()},
           performDiagonalFiltering_{performDiagonalFiltering.get()},
           performGeometricHashing_{performGeometricHashing.get()},
           preAddNeighbouringCubes_{preAddNeighbouringCubes.get()},
@@ -186,7 +223,13 @@ public:
           preMaskCollection_{preMaskCollection.get()},
           preOptimalSeed_{preOptimalSeed.get()},
           postSequential_{postSequential.get()},
+          presenceFilter_{presenceFilter.get()},
           redmask_{redmask.get()},
+          referenceSampling_{referenceSampling.get()},
+          seedIndex_{seedIndex.get()},
+          seedPartitions_{seedPartitions.get()},
+          sortedSeedIndex_{sortedSeedIndex.get()},
+          spillDirectory_{spillDirectory.get()},
           thinning_{thinning.get()},
           tileSize_{tileSize.get()},
           verbose_{verbose.get()},
@@ -199,10 +242,20 @@ public:
     auto allowOverlap() const { return allowOverlap_; }
     //! Getter function for member \c allvsall_
     auto allvsall() const { return allvsall_; }
+    //! Getter function for member \c artificialSequenceSeed_
+    auto artificialSequenceSeed() const { return artificialSequenceSeed_; }
     //! Getter function for member \c artificialSequenceSizeFactor_
     auto artificialSequenceSizeFactor() const { return artificialSequenceSizeFactor_; }
     //! Getter function for member \c batchsize_
     auto const & batchsize() const { return batchsize_; }
+    //! Getter function for member \c buildSeedIndex_
+    auto const & buildSeedIndex() const { return buildSeedIndex_; }
+    //! Getter function for member \c canonicalSeeds_
+    auto canonicalSeeds() const { return canonicalSeeds_; }
+    //! Getter function for member \c compressPostings_
+    auto compressPostings() const { return compressPostings_; }
+    //! Getter function for member \c countSeeds_
+    auto countSeeds() const { return countSeeds_; }
     //! Flag if only matches from seeds that occur in both genome 0 and 1 should be created
     auto createAllMatches() const { return createAllMatches_; }
     //! Return a JsonValue of a json dict of this configuration with parameters as keys and their respective values
@@ -231,6 +284,8 @@ public:
     auto const & genome1() const { return genome1_; }
     //! Getter function for member \c genome2_
     auto const & genome2() const { return genome2_; }
+    //! Getter function for member \c genomeCache_
+    auto const & genomeCache() const { return genomeCache_; }
     //! Getter function for member \c hasse_
     auto hasse() const { return hasse_; }
     //! Getter function for member \c inputFiles_
@@ -249,6 +304,8 @@ public:
     auto maxPrefixLength() const { return maxPrefixLength_; }
     //! Getter function for member \c minMatchDistance_
     auto minMatchDistance() const { return minMatchDistance_; }
+    //! Getter function for member \c minimizerWindow_
+    auto minimizerWindow() const { return minimizerWindow_; }
     //! Getter function for member \c nThreads_
     auto nThreads() const { return nThreads_; }
     //! Getter funciton for member \c occurrencePerGenomeMax_
@@ -267,6 +324,8 @@ public:
     auto const & outputArtificialSequences() const { return outputArtificialSequences_; }
     //! Getter function for member \c outputRunInformation_
     auto const & outputRunInformation() const { return outputRunInformation_; }
+    //! Getter function for member \c parallelLinkCreation_
+    auto parallelLinkCreation() const { return parallelLinkCreation_; }
     //! Getter fucntion for member \c performDiagonalFiltering_
     auto performDiagonalFiltering() const { return performDiagonalFiltering_; }
     //! Getter fucntion for member \c performGeometricHashing_
@@ -283,10 +342,22 @@ public:
     auto preOptimalSeed() const { return preOptimalSeed_; }
     //! Getter function for member \c postSequential_
     auto postSequential() const { return postSequential_; }
+    //! Getter function for member \c presenceFilter_
+    auto presenceFilter() const { return presenceFilter_; }
     //! Getter function for member \c redmask_
     auto redmask() const { return redmask_; }
+    //! Getter function for member \c referenceSampling_
+    auto referenceSampling() const { return referenceSampling_; }
+    //! Getter function for member \c seedIndex_
+    auto const & seedIndex() const { return seedIndex_; }
+    //! Getter function for member \c seedPartitions_
+    auto seedPartitions() const { return seedPartitions_; }
     //! Forward to getter function for size of SpacedSeedMaskCollection
     auto seedSetSize() const { return maskCollection_->size(); }
+    //! Getter function for member \c sortedSeedIndex_
+    auto sortedSeedIndex() const { return sortedSeedIndex_; }
+    //! Getter function for member \c spillDirectory_
+    auto const & spillDirectory() const { return spillDirectory_; }
     //! Forward to getter function for maxSpan of SpacedSeedMaskCollection
     auto span() const { return maskCollection_->maxSpan(); }
     //! Getter function for member \c thinning_
@@ -326,10 +397,20 @@ protected:
     bool allowOverlap_;
     //! Create Links from all-vs-all sequences (as opposed to one refseq against all non-ref at a time)
     bool allvsall_;
+    //! Seed from which all artificial sequences are generated
+    size_t artificialSequenceSeed_;
     //! Create artificial sequence(s) of (sum of) lengths of this times the length of the input sequences
     size_t artificialSequenceSizeFactor_;
     //! Run pipeline from batches of this size
     size_t batchsize_;
+    //! Build a seed index of the input genomes, write it to this file and exit, not used if empty
+    fs::path buildSeedIndex_;
+    //! Store each seed once under the smaller of its forward and reverse strand form, finds reverse strand matches
+    bool canonicalSeeds_;
+    //! Seeds with at least this many occurrences (per mask) store them delta and varint compressed in the sorted seed index (0: never)
+    size_t compressPostings_;
+    //! Count all seeds in a first pass, reserve the seed map and do not store seeds that fail the occurrence limits
+    bool countSeeds_;
     //! If true, also create matches from seeds that not occur in genome 0 or 1
     bool createAllMatches_;
     //! [M6] Parameter for cube score computation
@@ -344,9 +425,9 @@ protected:
     size_t cubeScoreParameterChunks_;
     //! [M6] Cubes must have at least this score
     double cubeScoreThreshold_;
-    //! [M4] Diagonal difference parameter
+    //! [M4] Diagonal difference parameter, only computed with diagonal filtering (0 otherwise)
     size_t diagonalDelta_;
-    //! [M4] Position difference parameter
+    //! [M4] Position difference parameter, only computed with diagonal filtering (0 otherwise)
     size_t diagonalRho_;
     //! [M4] Threshold after how many neighbouring matches a match is reported
     double diagonalThreshold_;
@@ -356,6 +437,8 @@ protected:
     std::string genome1_;
     //! Find matches between this and \c genome1_
     std::string genome2_;
+    //! Binary cache of the preprocessed input genomes, not used if empty
+    fs::path genomeCache_;
     //! [M6] perform hasse subcube stuff
     bool hasse_;
     //! List of input fasta files (one file per genome)
@@ -368,11 +451,13 @@ protected:
     size_t matchLimit_;
     //! Discard seeds that give more matches (or Link s) than \c matchLimit_ allows
     bool matchLimitDiscardSeeds_;
-    //! For SeedOccurrenceMap, determines base RAM usage vs. query time
+    //! Upper bound for the number of seed bases that index the prefix table of a SeedIndex
     size_t maxPrefixLength_;
     //! [M4] Minimal distance between two neighbouring matches
     /*! Has no effect if \c allowOverlap_ is \c true */
     size_t minMatchDistance_;
+    //! Keep only the minimizer seed positions of each window of this many consecutive positions (1: keep all)
+    size_t minimizerWindow_;
     //! Number of threads to use in parallel processing steps
     size_t nThreads_;
     //! At most this many occurrences of a seed in any genome
@@ -391,6 +476,8 @@ protected:
     fs::path outputArtificialSequences_;
     //! File to store run info (json)
     fs::path outputRunInformation_;
+    //! Create the links of the seed map partitions in parallel, with one Linkset per thread
+    bool parallelLinkCreation_;
     //! Flag to perform M4
     bool performDiagonalFiltering_;
     //! Flag to perform M6
@@ -407,8 +494,20 @@ protected:
     bool preOptimalSeed_;
     //! [M5] If set, run the second GH step sequentially rather than in parallel
     bool postSequential_;
+    //! Only store seeds that occur in the reference and another genome, according to Bloom filters built in a first pass
+    bool presenceFilter_;
     //! Discard low-complexity seeds (only one or two nt in seed), like YASS
     bool redmask_;
+    //! Seed the reference genome (ID 0) only at every this many positions, other genomes at all positions
+    size_t referenceSampling_;
+    //! Seed index written by '--build-seed-index', only the query genomes are read from the input and matched against it
+    fs::path seedIndex_;
+    //! Number of on-disk partitions the seeds are spilled to, one partition at a time is held in memory (1: no spilling)
+    size_t seedPartitions_;
+    //! Build the seed map as sorted, compressed sparse row index instead of a hash map
+    bool sortedSeedIndex_;
+    //! Directory for the partition files of '--seed-partitions'
+    fs::path spillDirectory_;
     //! Discard roughly 1/thinning_ of input k-mers
     size_t thinning_;
     //! [M6] Tile size for geometricHashing
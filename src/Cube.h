@@ -25,26 +25,22 @@ class Tiledistance {
 public:
     //! Constructor
     Tiledistance(uint8_t genomeID, uint32_t sequenceID, long long distance, bool reverseStrand)
-        : occurrence_{KmerOccurrence(0,0,0,false,"")} {
-        // bits for position: pppp pppp pppp pppp pppp pppp pppp pppp pppp pppp
-        // i.e.             0xf    f    f    f    f    f    f    f    f    f
-        // LSB needed for sign, so only allow numbers [-0x7fffffffff, 0x7fffffffff]
+        : occurrence_{KmerOccurrence(0, 0, 0, false, BiggerKmerStored{false})} {
+        // LSB of the position field is needed for sign, so only allow numbers [-maxPosition/2, maxPosition/2]
         auto negative = false;
         if (distance < 0) {
             negative = true;
             distance *= -1;
         }
-        if (distance > 0x7fffffffff) { throw std::runtime_error("[ERROR] -- Tiledistance -- Distance too large"); }
-        auto bits = std::bitset<40>(distance);
-        bits <<= 1;
-        if (negative) { bits.set(0); }
-        occurrence_ = KmerOccurrence(genomeID, sequenceID, bits.to_ullong(), reverseStrand, "");
+        auto maxDistance = KmerOccurrence::layout().maxPosition() >> 1;
+        if (static_cast<unsigned long long>(distance) > maxDistance) { throw std::runtime_error("[ERROR] -- Tiledistance -- Distance too large"); }
+        auto bits = (static_cast<unsigned long long>(distance) << 1) | (negative ? 1ULL : 0ULL);
+        occurrence_ = KmerOccurrence(genomeID, sequenceID, bits, reverseStrand, BiggerKmerStored{false});
     }
     auto distance() const {
-        auto bits = std::bitset<80>(occurrence_.position());
-        auto negative = bits.test(0);
-        bits >>= 1; // remove sign bit
-        auto totalDist = bits.to_ullong();
+        auto bits = static_cast<unsigned long long>(occurrence_.position());
+        auto negative = bits & 1ULL;
+        auto totalDist = bits >> 1; // remove sign bit
         auto distance = (negative)
                 ? static_cast<long long>(totalDist) * -1
                 : static_cast<long long>(totalDist);
@@ -266,22 +266,24 @@ public:
         if (!silent) { std::cout << "[INFO] -- counting links in cubes" << std::endl; }
         Timestep tsCount{"counting links in cubes", silent};
         ProgressBar pb(seedMap.size(), config_->verbose() < 2 || silent);
-        Linkset<Link, LinkHashIgnoreSpan, LinkEqualIgnoreSpan> linkset(config_, idMap_);
+        Linkset<Link, LinkHashIgnoreSpan, LinkEqualIgnoreSpan> linkset(config_, idMap_, sequenceLengths_);
         // wrapper
-        auto processingFunction = [this](
+        size_t span = 1;
+        auto processingFunction = [this, &span](
                 std::vector<tsl::hopscotch_map<size_t,
                                                tsl::hopscotch_set<KmerOccurrence,
                                                                   KmerOccurrencePositionHash,
                                                                   KmerOccurrencePositionEqual>>> const & occurrenceMap,
                 size_t nPossible) {
-            countLinks(occurrenceMap, nPossible);
+            countLinks(occurrenceMap, nPossible, span);
         };
-        for (auto&& elem : seedMap.seedMap()) {
-            for (auto&& occurrences : elem.second) {
-                linkset.processOccurrences(occurrences, processingFunction, config_->preHasse());
+        seedMap.forEachSeed([this, &span, &pb, &linkset, &processingFunction](auto const &, SeedOccurrences const & occurrences) {
+            for (size_t maskID = 0; maskID < occurrences.size(); ++maskID) {
+                span = config_->preMaskCollection()->span(maskID);
+                linkset.processOccurrences(occurrences.at(maskID), processingFunction, config_->preHasse());
             }
             ++pb;
-        }
+        });
         tsCount.endAndPrint();
         // score and save relevant cubes
         if (!silent) { std::cout << "[INFO] -- scoring cubes via link count" << std::endl; }
@@ -392,7 +394,7 @@ private:
     void countLinks(std::vector<tsl::hopscotch_map<size_t, tsl::hopscotch_set<KmerOccurrence,
                                                                               KmerOccurrencePositionHash,
                                                                               KmerOccurrencePositionEqual>>> const & occurrenceMap,
-                                                   size_t nPossible) {
+                                                   size_t nPossible, size_t span) {
         // create all links (resp. cubes) and count links per cube
         nLinksTotal_ += nPossible;
         // flatten occurrenceMap
@@ -410,7 +412,9 @@ private:
         }
         // count cubes
         for (size_t id = 0; id < nPossible; ++id) {
-            Link link{cartesianProductByID(id, allOccs), 1}; // span doesn't matter
+            auto tiles = cartesianProductByID(id, allOccs);
+            if (config_->canonicalSeeds()) { orientOccurrences(tiles, span, *sequenceLengths_); }
+            Link link{tiles, 1}; // span doesn't matter
             auto cube = std::make_shared<Cube>(link, config_->tileSize());
             if (cubeMap_.find(cube) == cubeMap_.end()) {
                 cubeMap_[cube] = 0;
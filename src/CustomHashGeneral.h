@@ -2,6 +2,7 @@
 #define CUSTOMHASHGENERAL_H
 
 #include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
 
@@ -16,6 +17,15 @@ inline void customCombineHash(size_t & seed, size_t hash) {
 
 
 
+//! Bit mixer (SplitMix64 finalizer), every input bit affects every output bit
+inline uint64_t mixHash64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+
 //! Computes Hash value of an array
 template <typename T, size_t N, typename THash>
 struct ArrayHash {
@@ -7,6 +7,7 @@
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "mabl3/ProgressBar.h"
 #include "mabl3/Timestep.h"
@@ -14,12 +15,18 @@
 #include "Configuration.h"
 #include "ContainerChunks.h"
 #include "FastaCollection.h"
+#include "FastaCollectionView.h"
 #include "FastaRepresentation.h"
 #include "IdentifierMapping.h"
 #include "KmerOccurrence.h"
 #include "ParallelizationUtils.h"
 #include "ParallelProgressBarHandler.h"
+#include "RollingKmerWindow.h"
+#include "SeedIndex.h"
+#include "SpacedSeedGather.h"
 #include "TwoBitKmer.h"
+#include "TwoBitSequence.h"
+#include "WindowMinimizers.h"
 
 using namespace mabl3;
 
@@ -42,147 +49,274 @@ public:
                  std::shared_ptr<IdentifierMapping const> idMap,
                  std::shared_ptr<Configuration const> config)
         : config_{config}, idMap_{idMap},
-          maskCollection_{maskCollection}, mutexMemberAccess_{},
-          mutexOutput_{}, stringhasher_{} {}
-
-    //! Create all spaced seeds from a valid k-mer and call the callback for inserting that seed into a SeedMapType
-    template <typename SeedInsertCallbackType>
-    void createSeed(std::string const & kmer, SeedInsertCallbackType insertValue,
-                    std::function<void(TwoBitKmer<TwoBitSeedDataType>, SeedInsertCallbackType, size_t)> const & seedInsertCallback) const {
-        if (kmer.length() < maskCollection_->maxSpan()) { throw std::runtime_error("[ERROR] -- ExtractSeeds::createSeed() -- Kmer too short"); }
-        for (char c : kmer) {
-            if ((c != 'A') && (c != 'C') && (c != 'G') && (c != 'T')) { return; }
-        }
-        for (size_t i = 0; i < maskCollection_->size(); ++i) {
-            // create spaced seed
-            bool lowComplexity = false;
-            auto seed = seedFromKmer(kmer, maskCollection_->masks().at(i), lowComplexity);
-            // insert seed, possibly checking for low complexity
-            if ((!lowComplexity) || (!config_->redmask())) { seedInsertCallback(seed, insertValue, i); }
+          maskCollection_{maskCollection}, mutexBuffers_{},
+          mutexOutput_{}, seedGathers_{}, blockGathers_{true}, gatherKernel_{SpacedSeedGather::bestKernel()} {
+        for (auto&& mask : maskCollection_->masks()) {
+            seedGathers_.emplace_back(mask);
+            blockGathers_ = blockGathers_ && seedGathers_.back().blockCompatible();
         }
     }
-    //! Run seed extraction from fasta
-    void extractFromFastas(std::shared_ptr<FastaCollection const> fastaCollection,
-                           std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> seedInsertCallback,
-                           bool parallel = true) {
-        bool silent = (!parallel) || (config_->verbose() == 0); // assume that this is called from multiple threads if parallel not allowed, thus run silently
-        // Search for genome0 and 1 in inputFiles and abort if not found
-        validateInputFiles(*fastaCollection);
-        // Run extraction
+
+    //! Run seed extraction from fasta, collecting the seeds in record buffers instead of inserting them
+    /*! Each thread fills its own buffer without any locking, buffers are handed over once a thread is done.
+     * Use with SeedIndex::build()
+     * \param keep If set, only seeds for which \c keep(seed, maskIndex) returns \c true are collected */
+    std::vector<std::vector<SeedRecord<TwoBitSeedDataType>>> extractRecordsFromFastas(std::shared_ptr<FastaCollectionView const> fastaCollection,
+                                                                                      bool parallel = true,
+                                                                                      std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> keep = nullptr) {
+        std::vector<std::vector<SeedRecord<TwoBitSeedDataType>>> buffers;
         auto wrapper = [this,
-                        &seedInsertCallback](ParallelProgressBar & pb,
-                                             typename FastaRepresentation::FastaMapType::const_iterator sequencesIt,
-                                             typename FastaRepresentation::FastaMapType::const_iterator sequencesEnd){
-            readSequenceParallel(seedInsertCallback, pb, sequencesIt, sequencesEnd);
+                        &buffers,
+                        &keep](ParallelProgressBar & pb,
+                               typename FastaCollectionView::SequenceVector::const_iterator sequencesIt,
+                               typename FastaCollectionView::SequenceVector::const_iterator sequencesEnd){
+            auto buffer = bufferSequences(pb, sequencesIt, sequencesEnd, keep);
+            std::unique_lock<std::mutex> buffersLock(mutexBuffers_);
+            buffers.emplace_back(std::move(buffer));
         };
-        // read files one by one and fill seedMap_
-        for (auto&& elem : fastaCollection->collection()) {
-            auto& fasta = elem.second;
-            size_t nthreads = parallel ? config_->nThreads() : 1;
-            Timestep ts("Extracting k-mers from " + fasta.genome() + " on "
-                        + std::to_string(nthreads) + " threads",
-                        silent);
-            ParallelProgressBar pb(fasta.numSequences(), (silent || (config_->verbose() < 2)));
-            if (parallel && config_->nThreads() > 1) {
-                executeParallel(fasta.headerToSequence(),
-                                config_->nThreads(),
-                                wrapper, std::ref(pb));
-            } else {
-                readSequences(fasta, seedInsertCallback, pb);
+        auto sequential = [this,
+                           &buffers,
+                           &keep](FastaCollectionView::SequenceVector const & sequences,
+                                  ParallelProgressBar & pb) {
+            buffers.emplace_back(bufferSequences(pb, sequences.begin(), sequences.end(), keep));
+        };
+        processGenomes(*fastaCollection, wrapper, sequential, parallel);
+        return buffers;
+    }
+    //! Run seed extraction from fasta, each thread inserts its seeds through its own sink
+    /*! \c makeSink() is called once per thread, the returned sink is called as \c sink(seed, occurrence, maskIndex)
+     * for each seed and \c sink.flush() is called when the thread is done. Sinks synchronize among themselves
+     * \param keep If set, only seeds for which \c keep(seed, maskIndex) returns \c true are passed to the sinks */
+    template <typename SinkFactory>
+    void extractIntoSinks(std::shared_ptr<FastaCollectionView const> fastaCollection,
+                          SinkFactory makeSink,
+                          bool parallel = true,
+                          std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> keep = nullptr) {
+        auto wrapper = [this,
+                        &keep,
+                        &makeSink](ParallelProgressBar & pb,
+                                   typename FastaCollectionView::SequenceVector::const_iterator sequencesIt,
+                                   typename FastaCollectionView::SequenceVector::const_iterator sequencesEnd){
+            auto sink = makeSink();
+            std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> callback
+                    = [&keep, &sink](TwoBitKmer<TwoBitSeedDataType> seed, KmerOccurrence occ, size_t i) {
+                if (!keep || keep(seed, i)) { sink(seed, occ, i); }
+            };
+            processSequences(pb, sequencesIt, sequencesEnd, callback);
+            sink.flush();
+        };
+        auto sequential = [&wrapper](FastaCollectionView::SequenceVector const & sequences,
+                                     ParallelProgressBar & pb) {
+            wrapper(pb, sequences.begin(), sequences.end());
+        };
+        processGenomes(*fastaCollection, wrapper, sequential, parallel);
+    }
+
+protected:
+    //! Check if '--reference-sampling' or thinning lead to discarding the k-mer in \c window
+    /*! \param position Position of \c window in its sequence
+     * \param stride Only windows at multiples of \c stride are kept, see \c samplingStride() */
+    bool discardKmer(RollingKmerWindow const & window, size_t position, size_t stride) const {
+        return (position % stride != 0)
+               || ((config_->thinning() > 1) && ((window.hash() % config_->thinning()) == 1));
+    }
+    //! Distance of the seeded positions in the genome with ID \c genomeID, see '--reference-sampling'
+    size_t samplingStride(size_t genomeID) const { return (genomeID == 0) ? config_->referenceSampling() : 1; }
+    //! Call \c process(window, position) for each kept window of \c sequence, in order of their positions
+    /*! Only full windows of uppercase ACGT runs are considered. With '--minimizer-window' w, the windows of each
+     * run are keyed by \c minimizerKey() and streamed through a WindowMinimizerStream. A minimizer is reported
+     * at most w - 1 windows after its own, so the last w windows are kept in a ring and the memory does not
+     * depend on the run length. The remaining windows are filtered by \c discardKmer() */
+    template <typename F>
+    void forEachKeptWindow(TwoBitSequence const & sequence, size_t genomeID, F process) const {
+        auto span = maskCollection_->maxSpan();
+        auto stride = samplingStride(genomeID);
+        auto w = seedGathers_.empty() ? 1 : config_->minimizerWindow();
+        RollingKmerWindow window(span);
+        WindowMinimizerStream minimizers(w);
+        std::vector<RollingKmerWindow> ring;    // window with offset k in its run at ring[k % w]
+        std::vector<uint64_t> seed(seedGathers_.size() ? seedGathers_.front().wordCount() : 0);
+        std::vector<uint64_t> seedRC(seed.size());
+        auto emit = [&](RollingKmerWindow const & kept, size_t position) {
+            if (!discardKmer(kept, position, stride)) { process(kept, position); }
+        };
+        sequence.forEachUnmaskedACGTRun([&](size_t runBegin, size_t runEnd) {
+            if (runEnd - runBegin < span) { return; }
+            window.reset();
+            minimizers.reset();
+            auto packed = sequence.word(runBegin / 32) >> (2 * (runBegin % 32));
+            for (auto p = runBegin; p < runEnd; ++p, packed >>= 2) {
+                if (p % 32 == 0) { packed = sequence.word(p / 32); }
+                window.push(packed & 3);
+                if (!window.full()) { continue; }
+                auto offset = p + 1 - span - runBegin;
+                if (w <= 1) {
+                    emit(window, runBegin + offset);
+                    continue;
+                }
+                if (ring.size() < w && ring.size() <= offset) { ring.emplace_back(window); } else { ring[offset % w] = window; }
+                auto selected = minimizers.push(minimizerKey(window, seed, seedRC));
+                if (selected != WindowMinimizerStream::npos) { emit(ring[selected % w], runBegin + selected); }
             }
-            pb.unprotectedProgressBar().finish();
-            ts.endAndPrint();
+            auto selected = minimizers.finish();
+            if (selected != WindowMinimizerStream::npos) { emit(ring[selected % w], runBegin + selected); }
+        });
+    }
+    //! Key of \c window for '--minimizer-window', the hash of its seed of the first mask (of the smaller strand with canonical seeds)
+    /*! \param seed, seedRC Buffers for the gathered seeds */
+    size_t minimizerKey(RollingKmerWindow const & window, std::vector<uint64_t> & seed, std::vector<uint64_t> & seedRC) const {
+        auto& gather = seedGathers_.front();
+        gather.gather(window.forward(), seed.data());
+        auto stored = seed.data();
+        if (config_->canonicalSeeds()) {
+            gather.gather(window.reverseComplement(), seedRC.data());
+            if (seedLess(seedRC.data(), seed.data(), seed.size())) { stored = seedRC.data(); }
         }
+        size_t key = 0;
+        for (size_t i = 0; i < seed.size(); ++i) { customCombineHash(key, mixHash64(stored[i])); }
+        return key;
     }
-    static TwoBitKmer<TwoBitSeedDataType> seedFromKmer(std::string const & kmer, SpacedSeedMask const & mask,
-                                                       bool & lowComplexity) {
-        tsl::hopscotch_set<char> bases;
-        auto setBits = mask.getSetPositions();
-        std::string inducedSeed;
-        for (auto&& pos : setBits) {
-            inducedSeed += kmer.at(pos);
-            bases.emplace(kmer.at(pos));
+    //! Compare two packed seeds of \c n words by their integer value (highest word first)
+    static bool seedLess(uint64_t const * lhs, uint64_t const * rhs, size_t n) {
+        for (auto i = n; i > 0; --i) {
+            if (lhs[i - 1] != rhs[i - 1]) { return lhs[i - 1] < rhs[i - 1]; }
         }
-        lowComplexity = (bases.size() <= 2);
-        return TwoBitKmer<TwoBitSeedDataType>{inducedSeed};
+        return false;
     }
-
-protected:
-    //! Check if thinning leads to discarding this kmer
-    bool discardKmer(std::string const & kmer) const {
-        auto hash = stringhasher_(kmer);
-        return ((hash % config_->thinning()) == 1);
+    //! Occurrence of the seed of mask \c maskIndex gathered from the reverse complement of the window at \c windowPosition
+    /*! Stores the forward position of the bases covered by the mask and sets the reverse strand bit */
+    KmerOccurrence reverseOccurrence(size_t genomeID, size_t sequenceID, size_t windowPosition,
+                                     size_t maskIndex, bool biggerKmerStored) const {
+        return KmerOccurrence(genomeID, sequenceID,
+                              windowPosition + maskCollection_->maxSpan() - seedGathers_[maskIndex].span(), true,
+                              BiggerKmerStored{biggerKmerStored});
     }
     //! Extract seeds from a single sequence
-    void extractSeeds(std::string const & sequence,
+    /*! Only runs of uppercase ACGT can yield seeds. The packed bases of each run are rolled through a
+     * RollingKmerWindow and the spaced seeds are gathered from the window without decoding the sequence.
+     *
+     * With canonical seeds, the seed is also gathered from the reverse complement of the window and the
+     * smaller of both is stored, the occurrence is marked as reverse if that is the reverse strand seed */
+    void extractSeeds(TwoBitSequence const & sequence,
                       size_t sequenceID,
                       size_t genomeID,
                       std::string const & sequenceName,
                       std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> seedInsertCallback,
                       std::unique_lock<std::mutex> & outputLock) {
-        if (sequence.size() < maskCollection_->maxSpan()) {
+        auto span = maskCollection_->maxSpan();
+        if (sequence.size() < span) {
             outputLock.lock();
             std::cerr << "[WARNING] -- ExactKmerMap -- Sequence " << sequenceName
-                      << " is shorter than l (" << maskCollection_->maxSpan() << ")" << std::endl;
+                      << " is shorter than l (" << span << ")" << std::endl;
             outputLock.unlock();
         } else {
-            for (size_t p = 0; p < (sequence.size() - maskCollection_->maxSpan() + 1); ++p) {
-                auto kmer = sequence.substr(p, maskCollection_->maxSpan());
-                if (discardKmer(kmer)) { continue; }
-                //TwoBitKmer<TwoBitKmerDataType> twoBitKmer(kmer, validFlag);
-                auto occurrence = KmerOccurrence(genomeID, sequenceID, p, false, kmer);
-                createSeed(kmer, occurrence, seedInsertCallback);
+            if (blockGathers_) {
+                extractSeedsBlockwise(sequence, sequenceID, genomeID, seedInsertCallback);
+                return;
             }
+            std::vector<uint64_t> seed(seedGathers_.size() ? seedGathers_.front().wordCount() : 0);
+            std::vector<uint64_t> seedRC(seed.size());
+            auto canonical = config_->canonicalSeeds();
+            auto redmask = config_->redmask();
+            forEachKeptWindow(sequence, genomeID, [&](RollingKmerWindow const & window, size_t position) {
+                auto occurrence = KmerOccurrence(genomeID, sequenceID, position, false,
+                                                 BiggerKmerStored{window.forwardIsBigger()});
+                for (size_t i = 0; i < seedGathers_.size(); ++i) {
+                    seedGathers_[i].gather(window.forward(), seed.data());
+                    auto reverse = false;
+                    if (canonical) {
+                        seedGathers_[i].gather(window.reverseComplement(), seedRC.data());
+                        reverse = seedLess(seedRC.data(), seed.data(), seed.size());
+                    }
+                    auto stored = reverse ? seedRC.data() : seed.data();
+                    // insert seed, possibly checking for low complexity
+                    if ((!redmask) || (!seedGathers_[i].lowComplexity(stored))) {
+                        seedInsertCallback(TwoBitKmer<TwoBitSeedDataType>(stored, seedGathers_[i].weight()),
+                                           reverse ? reverseOccurrence(genomeID, sequenceID, position, i,
+                                                                       !window.forwardIsBigger() && !window.palindromic())
+                                                   : occurrence,
+                                           i);
+                    }
+                }
+            });
         }
     }
-    //! Process sequences from a fasta representation, directly creating seed ins seedMap
-    void readSequences(FastaRepresentation const & fasta,
-                       std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> const & seedInsertCallback,
-                       ParallelProgressBar & pb) {
-        std::unique_lock<std::mutex> outputLock(mutexOutput_, std::defer_lock); // dummy for extractSeeds()
-        auto stepSize = pb.unprotectedProgressBar().step();
-        size_t processedSequences = 0;
-        for (auto&& elem : fasta.headerToSequence()) {
-            auto& fastaSequence = elem.second;
-            auto& sequence = fastaSequence.sequence();
-            auto& sequenceName = fastaSequence.sequenceName();
-            auto& genomeName = fastaSequence.genomeName();
-            auto sequenceID = idMap_->querySequenceIDConst(sequenceName, genomeName);
-            auto genomeID = idMap_->queryGenomeIDConst(genomeName);
-            extractSeeds(sequence,
-                         sequenceID,
-                         genomeID,
-                         sequenceName,
-                         seedInsertCallback, // directly insert
-                         outputLock);
-            ++processedSequences;
-            // update progress bar occasionally
-            if (processedSequences >= stepSize) {
-                //pb += processedSequences;
-                pb.increase(processedSequences);
-                processedSequences = 0;
+    //! Extract seeds from a single sequence, gathering the seeds of a block of windows at once
+    /*! Requires \c blockGathers_, i.e. spans <= 64 and weights <= 32. The (at most two) forward words of
+     * each window (and of its reverse complement with canonical seeds) are buffered and the seeds of each
+     * mask are created with SpacedSeedGather::gatherBlock() */
+    void extractSeedsBlockwise(TwoBitSequence const & sequence,
+                               size_t sequenceID,
+                               size_t genomeID,
+                               std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> & seedInsertCallback) {
+        auto canonical = config_->canonicalSeeds();
+        auto redmask = config_->redmask();
+        std::vector<uint64_t> lo, hi, loRC, hiRC, seeds(blockSize_), seedsRC(blockSize_);
+        std::vector<KmerOccurrence> occurrences;
+        std::vector<bool> biggerRC;
+        lo.reserve(blockSize_);
+        hi.reserve(blockSize_);
+        occurrences.reserve(blockSize_);
+        auto flush = [&]() {
+            for (size_t i = 0; i < seedGathers_.size(); ++i) {
+                seedGathers_[i].gatherBlock(lo.data(), hi.data(), lo.size(), seeds.data(), gatherKernel_);
+                if (canonical) { seedGathers_[i].gatherBlock(loRC.data(), hiRC.data(), loRC.size(), seedsRC.data(), gatherKernel_); }
+                for (size_t j = 0; j < lo.size(); ++j) {
+                    auto reverse = canonical && seedsRC[j] < seeds[j];
+                    auto stored = reverse ? &seedsRC[j] : &seeds[j];
+                    if ((!redmask) || (!seedGathers_[i].lowComplexity(stored))) {
+                        seedInsertCallback(TwoBitKmer<TwoBitSeedDataType>(stored, seedGathers_[i].weight()),
+                                           reverse ? reverseOccurrence(genomeID, sequenceID, occurrences[j].position(), i, biggerRC[j])
+                                                   : occurrences[j],
+                                           i);
+                    }
+                }
             }
-        }
-        // final progress bar update if neccessary
-        if (processedSequences > 0) {
-            pb.increase(processedSequences);
-        }
+            lo.clear();
+            hi.clear();
+            loRC.clear();
+            hiRC.clear();
+            occurrences.clear();
+            biggerRC.clear();
+        };
+        forEachKeptWindow(sequence, genomeID, [&](RollingKmerWindow const & window, size_t position) {
+            auto& forward = window.forward();
+            lo.emplace_back(forward[0]);
+            hi.emplace_back((forward.size() > 1) ? forward[1] : 0);
+            occurrences.emplace_back(genomeID, sequenceID, position, false,
+                                     BiggerKmerStored{window.forwardIsBigger()});
+            if (canonical) {
+                auto& reverseComplement = window.reverseComplement();
+                loRC.emplace_back(reverseComplement[0]);
+                hiRC.emplace_back((reverseComplement.size() > 1) ? reverseComplement[1] : 0);
+                biggerRC.emplace_back(!window.forwardIsBigger() && !window.palindromic());
+            }
+            if (lo.size() == blockSize_) { flush(); }
+        });
+        if (lo.size()) { flush(); }
     }
-    //! Process sequences from a fasta representation in parallel
-    void readSequenceParallel(std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> const & seedInsertCallback,
-                              ParallelProgressBar & pb,
-                              typename FastaRepresentation::FastaMapType::const_iterator sequencesIt,
-                              typename FastaRepresentation::FastaMapType::const_iterator sequencesEnd) {
-        // create locks but don't lock yet
-        std::unique_lock<std::mutex> memberAccessLock(mutexMemberAccess_, std::defer_lock);
-        std::unique_lock<std::mutex> outputLock(mutexOutput_, std::defer_lock);
-        std::vector< std::tuple<TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t> > occurrences;
-        auto bufferOccurrence = [&occurrences](TwoBitKmer<TwoBitSeedDataType> seed, KmerOccurrence occ, size_t i) {
-            occurrences.emplace_back(seed, occ, i);
+    //! Extract the seeds of a range of sequences into a record buffer
+    /*! If \c keep is set, only seeds for which \c keep(seed, maskIndex) returns \c true are buffered */
+    std::vector<SeedRecord<TwoBitSeedDataType>> bufferSequences(ParallelProgressBar & pb,
+                                                                typename FastaCollectionView::SequenceVector::const_iterator sequencesIt,
+                                                                typename FastaCollectionView::SequenceVector::const_iterator sequencesEnd,
+                                                                std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> const & keep = nullptr) {
+        std::vector<SeedRecord<TwoBitSeedDataType>> records;
+        std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> bufferOccurrence
+                = [&records, &keep](TwoBitKmer<TwoBitSeedDataType> seed, KmerOccurrence occ, size_t i) {
+            if (!keep || keep(seed, i)) { records.emplace_back(seed, occ, i); }
         };
-
+        processSequences(pb, sequencesIt, sequencesEnd, bufferOccurrence);
+        return records;
+    }
+    //! Extract the seeds of a range of sequences, calling \c seedCallback for each seed
+    void processSequences(ParallelProgressBar & pb,
+                          typename FastaCollectionView::SequenceVector::const_iterator sequencesIt,
+                          typename FastaCollectionView::SequenceVector::const_iterator sequencesEnd,
+                          std::function<void(TwoBitKmer<TwoBitSeedDataType>, KmerOccurrence, size_t)> const & seedCallback) {
+        std::unique_lock<std::mutex> outputLock(mutexOutput_, std::defer_lock);
         for (; sequencesIt != sequencesEnd; ++sequencesIt) {
-            auto& fastaSequence = (*sequencesIt).second;
+            auto& fastaSequence = **sequencesIt;
             auto& sequence = fastaSequence.sequence();
             auto& sequenceName = fastaSequence.sequenceName();
             auto& genomeName = fastaSequence.genomeName();
@@ -192,34 +326,53 @@ protected:
                          sequenceID,
                          genomeID,
                          sequenceName,
-                         bufferOccurrence,
+                         seedCallback,
                          outputLock);
             pb.increase();
         }
-
-        // create seeds
-        memberAccessLock.lock();
-        for (auto&& tuple : occurrences) {
-            seedInsertCallback(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
+    }
+    //! Run \c parallelFunction(pb, it, end) on chunks of the sequences of each genome or \c sequentialFunction(sequences, pb)
+    template <typename ParallelFunction, typename SequentialFunction>
+    void processGenomes(FastaCollectionView const & fastaCollection,
+                        ParallelFunction parallelFunction,
+                        SequentialFunction sequentialFunction,
+                        bool parallel) {
+        bool silent = (!parallel) || (config_->verbose() == 0); // assume that this is called from multiple threads if parallel not allowed, thus run silently
+        // Search for genome0 and 1 in inputFiles and abort if not found
+        validateInputFiles(fastaCollection);
+        // read files one by one
+        for (auto&& elem : fastaCollection.collection()) {
+            auto& sequences = elem.second;
+            size_t nthreads = parallel ? config_->nThreads() : 1;
+            Timestep ts("Extracting k-mers from " + elem.first + " on "
+                        + std::to_string(nthreads) + " threads",
+                        silent);
+            ParallelProgressBar pb(sequences.size(), (silent || (config_->verbose() < 2)));
+            if (parallel && config_->nThreads() > 1) {
+                executeParallel(sequences,
+                                config_->nThreads(),
+                                parallelFunction, std::ref(pb));
+            } else {
+                sequentialFunction(sequences, pb);
+            }
+            pb.unprotectedProgressBar().finish();
+            ts.endAndPrint();
         }
-        memberAccessLock.unlock();
-
-        return;
     }
     //! Helper factory function to check if input data is valid
-    void validateInputFiles(FastaCollection const & fastaCollection) const {
+    void validateInputFiles(FastaCollectionView const & fastaCollection) const {
         auto genome1Exists = false;
         auto genome2Exists = false;
         std::vector<std::string> inputGenomes;
         for (auto&& elem : fastaCollection.collection()) {
-            auto& file = elem.first;
-            std::filesystem::path path(file);
-            path.replace_extension("");
-            inputGenomes.emplace_back(path.filename());
-            if (path.filename() == config_->genome1()) { genome1Exists = true; }
-            if (path.filename() == config_->genome2()) { genome2Exists = true; }
+            auto& genome = elem.first;  // already stripped by FastaRepresentation::genomeFromFilename()
+            inputGenomes.emplace_back(genome);
+            if (genome == config_->genome1()) { genome1Exists = true; }
+            if (genome == config_->genome2()) { genome2Exists = true; }
         }
 
+        genome1Exists = genome1Exists || !config_->seedIndex().empty();         // reference is in the seed index
+        genome2Exists = genome2Exists || !config_->buildSeedIndex().empty();    // query genome is matched later
         if (!(genome1Exists && genome2Exists)) {
             std::cerr << std::endl << "Input genomes: " << inputGenomes << std::endl;
             throw std::runtime_error("[ERROR] -- ExactSeeds -- Genomes not present in input files");
@@ -232,12 +385,18 @@ protected:
     std::shared_ptr<IdentifierMapping const> idMap_;
     //! Masks used for seed creation
     std::shared_ptr<SpacedSeedMaskCollection const> maskCollection_;
-    //! Lock for member access of this class
-    std::mutex mutexMemberAccess_;
+    //! Lock for handing over the record buffers of \c extractRecordsFromFastas()
+    std::mutex mutexBuffers_;
     //! Lock for stdout
     std::mutex mutexOutput_;
-    //! For thinning
-    std::hash<std::string> stringhasher_;
+    //! Compiled masks from \c maskCollection_
+    std::vector<SpacedSeedGather> seedGathers_;
+    //! All masks are compatible with SpacedSeedGather::gatherBlock()
+    bool blockGathers_;
+    //! Kernel for SpacedSeedGather::gatherBlock(), chosen at runtime
+    SpacedSeedGather::Kernel gatherKernel_;
+    //! Number of windows that are gathered at once
+    static constexpr size_t blockSize_ = 256;
 };
 
 #endif // EXTRACTSEEDS_H
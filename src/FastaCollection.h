@@ -1,8 +1,16 @@
 #ifndef FASTACOLLECTION_H
 #define FASTACOLLECTION_H
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "Configuration.h"
 #include "FastaRepresentation.h"
@@ -12,23 +20,56 @@ class FastaCollection {
 public:
     //! c'tor (1)
     /*! Creates an empty collection */
-    FastaCollection() : collection_{} {}
+    FastaCollection() : collection_{}, loadTimes_{} {}
     //! c'tor (2)
     /*! \param config Shared pointer to program configuration object
      *
      * \details Creates and stores a FastaRepresentation for each input file
-     * specified in \c config */
+     * specified in \c config. Files are loaded concurrently, at most \c config->nThreads()
+     * at a time, the available threads are split among the files that are loaded at once */
     FastaCollection(std::shared_ptr<Configuration const> config)
-        : collection_{} {
-        for (auto&& file : config->inputFiles()) {
-            auto genomeName = FastaRepresentation::genomeFromFilename(file);
-            if (!config->dynamicArtificialSequences()) {
-                collection_.emplace(genomeName, FastaFileName{file});
-            } else {
-                collection_.emplace(genomeName, FastaRepresentation(FastaFileName{file},
-                                                                    config->artificialSequenceSizeFactor(),
-                                                                    FastaRepresentation::dynamicallyGenerateArtificialSequences));
+        : collection_{}, loadTimes_{} {
+        auto& files = config->inputFiles();
+        auto nThreads = std::max<size_t>(config->nThreads(), 1);
+        auto nInFlight = std::max<size_t>(std::min(files.size(), nThreads), 1);
+        auto threadsPerFile = FastaNumThreads{std::max<size_t>(nThreads / nInFlight, 1)};
+        std::vector<std::optional<FastaRepresentation>> fastas(files.size());
+        std::vector<double> loadTimes(files.size());
+        std::atomic<size_t> nextFile{0};
+        std::mutex mutexError;
+        std::exception_ptr error;
+        auto loadFiles = [&]() {
+            for (auto i = nextFile++; i < files.size(); i = nextFile++) {
+                try {
+                    Timestep ts("Loading " + files.at(i), true);
+                    if (!config->dynamicArtificialSequences()) {
+                        fastas.at(i).emplace(FastaFileName{files.at(i)}, threadsPerFile);
+                    } else {
+                        fastas.at(i).emplace(FastaFileName{files.at(i)},
+                                             config->artificialSequenceSizeFactor(),
+                                             FastaRepresentation::dynamicallyGenerateArtificialSequences,
+                                             config->artificialSequenceSeed(),
+                                             threadsPerFile);
+                    }
+                    loadTimes.at(i) = ts.elapsed(Timestep::minutes);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutexError);
+                    if (!error) { error = std::current_exception(); }
+                    nextFile = files.size();    // stop loading further files
+                }
             }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < nInFlight; ++i) { threads.emplace_back(loadFiles); }
+        loadFiles();
+        for (auto&& thread : threads) { thread.join(); }
+        if (error) { std::rethrow_exception(error); }
+        // insert in input order after all files are loaded, so the iteration order of collection_ does not depend on
+        // which file finished first. IDs are assigned in this (hash map) iteration order, not in input order
+        for (size_t i = 0; i < files.size(); ++i) {
+            auto genomeName = FastaRepresentation::genomeFromFilename(files.at(i));
+            collection_.emplace(genomeName, std::move(*fastas.at(i)));
+            loadTimes_.emplace(genomeName, loadTimes.at(i));
         }
     }
     //! Getter for member \c collection_
@@ -41,10 +82,16 @@ public:
     void emplace(std::string const & genomeName, FastaRepresentation const & fastaRepresentation) {
         collection_.emplace(genomeName, fastaRepresentation);
     }
+    //! Insert new FastaRepresentation without copying
+    void emplace(std::string const & genomeName, FastaRepresentation && fastaRepresentation) {
+        collection_.emplace(genomeName, std::move(fastaRepresentation));
+    }
     //! Getter for the FastaRepresentation of \c genomeName
     auto const & fastaRepresentation(std::string const & genomeName) const {
         return collection_.at(genomeName);
     }
+    //! Getter for member \c loadTimes_
+    auto const & loadTimes() const { return loadTimes_; }
     void fillSequenceLengths(tsl::hopscotch_map<size_t, size_t> & sequenceLengths,
                              IdentifierMapping const & idMap) const {
         for (auto&& fasta : collection_) {
@@ -77,7 +124,7 @@ public:
     }
     size_t sequenceLength(uint32_t sequenceID, IdentifierMapping const & idMap) const {
         auto& seq = fastaSequence(sequenceID, idMap);
-        return seq.sequence().size();
+        return seq.size();
     }
     friend std::ostream & operator<<(std::ostream & os, FastaCollection const & fc) {
         for (auto&& elem : fc.collection_) {
@@ -90,6 +137,8 @@ private:
     //! genomeName to FastaRepresentation
     std::unordered_map<std::string,
                        FastaRepresentation> collection_;
+    //! genomeName to time in minutes it took to load the genome
+    std::map<std::string, double> loadTimes_;
 };
 
 #endif // FASTACOLLECTION_H
@@ -0,0 +1,84 @@
+#ifndef FASTACOLLECTIONVIEW_H
+#define FASTACOLLECTIONVIEW_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tsl/hopscotch_map.h>
+#include "FastaCollection.h"
+#include "IdentifierMapping.h"
+
+//! Read-only view on (a subset of) the sequences in a FastaCollection
+/*! The view references the FastaSequences of the underlying collection instead of copying
+ * them, so creating a view for a batch or a sequence cluster is cheap. The underlying
+ * collection is kept alive by the view. */
+class FastaCollectionView {
+public:
+    //! Sequences of a single genome in the view
+    using SequenceVector = std::vector<FastaSequence const *>;
+
+    //! c'tor (1)
+    /*! \param fastaCollection Collection to view
+     *
+     * \details Creates a view on all sequences in \c fastaCollection */
+    FastaCollectionView(std::shared_ptr<FastaCollection const> fastaCollection)
+        : fastaCollection_{fastaCollection}, genomeToSequences_{} {
+        for (auto&& fasta : fastaCollection_->collection()) {
+            auto& sequences = genomeToSequences_[fasta.first];
+            sequences.reserve(fasta.second.numSequences());
+            for (auto&& seq : fasta.second.headerToSequence()) { sequences.emplace_back(&seq.second); }
+        }
+    }
+    //! c'tor (2)
+    /*! \param sequenceIDs IDs of the sequences in the view, must denote a subset of sequences present in \c fastaCollection
+     * \param fastaCollection Collection to view
+     * \param idMap IdentifierMapping that was populated from \c fastaCollection
+     *
+     * \details Creates a view on the sequences with IDs \c sequenceIDs */
+    FastaCollectionView(std::vector<size_t> const & sequenceIDs,
+                        std::shared_ptr<FastaCollection const> fastaCollection,
+                        IdentifierMapping const & idMap)
+        : fastaCollection_{fastaCollection}, genomeToSequences_{} {
+        for (auto sid : sequenceIDs) {
+            auto& genome = idMap.queryGenomeName(idMap.querySequenceTuple(sid).gid);
+            genomeToSequences_[genome].emplace_back(&fastaCollection_->fastaSequence(sid, idMap));
+        }
+    }
+    //! Getter for member \c genomeToSequences_
+    auto const & collection() const { return genomeToSequences_; }
+    //! Getter for member \c fastaCollection_
+    auto fastaCollection() const { return fastaCollection_; }
+    //! Insert the lengths of all sequences in the view into \c sequenceLengths
+    void fillSequenceLengths(tsl::hopscotch_map<size_t, size_t> & sequenceLengths,
+                             IdentifierMapping const & idMap) const {
+        for (auto&& elem : genomeToSequences_) {
+            for (auto seq : elem.second) {
+                sequenceLengths.emplace(idMap.querySequenceIDConst(seq->sequenceName(), elem.first), seq->size());
+            }
+        }
+    }
+    //! Number of sequences in the view
+    auto numSequences() const {
+        size_t n = 0;
+        for (auto&& elem : genomeToSequences_) { n += elem.second.size(); }
+        return n;
+    }
+    //! Assign IDs to all genomes and sequences in the view
+    void populateIdentifierMapping(IdentifierMapping & idMap) const {
+        for (auto&& elem : genomeToSequences_) {
+            idMap.queryGenomeID(elem.first);
+            for (auto seq : elem.second) {
+                idMap.querySequenceID(seq->sequenceName(), seq->genomeName());
+            }
+        }
+    }
+
+private:
+    //! Collection that holds the sequences
+    std::shared_ptr<FastaCollection const> fastaCollection_;
+    //! genomeName to sequences in the view
+    tsl::hopscotch_map<std::string, SequenceVector> genomeToSequences_;
+};
+
+#endif // FASTACOLLECTIONVIEW_H
@@ -1,108 +1,199 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
 #include "FastaRepresentation.h"
+#include "GzipDecompression.h"
+#include "MappedFile.h"
 
 namespace fs = std::filesystem;
 
-std::string FastaRepresentation::createRandomSequence(size_t length,
-                                                      std::uniform_int_distribution<uint8_t> & unif,
-                                                      std::default_random_engine & rng) {
-    auto bases = std::array<char, 4>{'A', 'C', 'G', 'T'};
-    auto seqVector = std::vector<char>(length);
-    for (size_t i = 0; i < length; ++i) {
-        seqVector[i] = bases.at(unif(rng)); // randomly concatenate bases
+TwoBitSequence FastaRepresentation::createRandomSequence(size_t length, uint64_t seed, std::string const & header) {
+    // FNV-1a of the header, so each artificial sequence gets its own stream independent of creation order
+    uint64_t sequenceSeed = 0xcbf29ce484222325ULL;
+    for (char c : header) {
+        sequenceSeed ^= static_cast<unsigned char>(c);
+        sequenceSeed *= 0x100000001b3ULL;
     }
-    auto seq = std::string(seqVector.begin(), seqVector.end());
-    return seq;
+    return TwoBitSequence::random(length, seed ^ sequenceSeed);
 }
 
 
 
-void FastaRepresentation::readFile(std::string const & fastaFile) {
+void FastaRepresentation::readFile(std::string const & fastaFile, size_t nThreads) {
     fs::path path(fastaFile);
     // Check if input file exists and is valid
     if (!fs::is_regular_file(path)) {
         auto msg = "[ERROR] -- FastaRepresentation -- " + fastaFile + " is not a regular file";
         throw std::runtime_error(msg);
     }
-    // Try to open file (non binary mode)
-    std::ifstream inputStream(path);
-    if (!inputStream.is_open()) {
+    // Map file into memory, no intermediate line buffers are needed for uncompressed input
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(fastaFile);
+    } catch (std::runtime_error const &) {
         auto msg = "[ERROR] -- FastaRepresentation -- Failed to open " + fastaFile;
         throw std::runtime_error(msg);
     }
-    // If file is opened successfully, try to read contents
-    std::string line;
-    std::string currentHead;
-    size_t lineCount{0};
-    // getline returns inputStream and as https://en.cppreference.com/w/cpp/io/basic_ios/operator_bool,
-    //     body only gets executed if getline was successful (i.e. no fail or read after eof)
-    while ( std::getline(inputStream, line) ) {
-        ++lineCount;
-        chomp(line);    // strip newline sequences from line
-        if (line.size() > 0) {  // skip empty lines
-            if (line.at(0) == '>') { // new sequence
-                line.erase(line.begin());   // remove ">"
-                currentHead = line;
-                // new (empty) sequence entry
-                headToSeq_.insert({currentHead, FastaSequence("", currentHead, filename_)});
-            } else if (line.at(0) == ';') { // skip comment line
-                continue;
-            } else {    // sequence line
-                if (currentHead.empty()) {
-                    auto msg = "[ERROR] -- FastaRepresentation -- Encountered non-header, non-comment line"
-                               "that does not belong to any sequence header in '" + fastaFile +
-                               "' in line " + std::to_string(lineCount);
-                    throw std::runtime_error(msg);
-                }
-                headToSeq_.at(currentHead).append(line);    // create contiguous sequence from respective entries
-            }
+    if (isGzipCompressed(file->data(), file->size())) {
+        // decompress into memory and parse from there, bgzip blocks are decompressed in parallel
+        auto buffer = decompressGzip(file->data(), file->size(), nThreads, fastaFile);
+        file.reset();
+        parseFasta(buffer.data(), buffer.size(), fastaFile, nThreads);
+    } else {
+        parseFasta(file->data(), file->size(), fastaFile, nThreads);
+    }
+}
+
+
+
+namespace {
+
+//! Location of a single fasta record inside a buffer
+struct FastaRecordLocation {
+    size_t headerBegin;     // first character after '>'
+    size_t headerEnd;       // past-the-end of header line, newline sequence excluded
+    size_t sequenceBegin;   // first character of the line after the header
+    size_t sequenceEnd;     // past-the-end of the record
+};
+
+//! Call \c function(lineBegin, lineEnd) on each non-empty, non-comment line in data[begin, end), newline sequences excluded
+/*! Lines are separated by '\n', each trailing '\r' of a line is removed */
+template <typename F>
+void forEachSequenceLine(char const * data, size_t begin, size_t end, F function) {
+    while (begin < end) {
+        auto newline = static_cast<char const *>(std::memchr(data + begin, '\n', end - begin));
+        size_t lineEnd = (newline) ? static_cast<size_t>(newline - data) : end;
+        size_t next = lineEnd + 1;
+        while (lineEnd > begin && data[lineEnd-1] == '\r') { --lineEnd; }
+        if (lineEnd > begin && data[begin] != ';') { function(begin, lineEnd); }  // skip empty and comment lines
+        begin = next;
+    }
+}
+
+} // namespace
+
+
+
+void FastaRepresentation::parseFasta(char const * data, size_t size, std::string const & fastaFile, size_t nThreads) {
+    if (nThreads == 0) { nThreads = 1; }
+    // Find record starts, i.e. all '>' at the beginning of a line, each thread scans a chunk of the buffer
+    auto nChunks = std::min(nThreads, std::max<size_t>(size / (1 << 20), 1));
+    std::vector<std::vector<size_t>> chunkRecordStarts(nChunks);
+    auto scanChunk = [data, size, nChunks, &chunkRecordStarts](size_t chunk) {
+        auto chunkBegin = (size / nChunks) * chunk;
+        auto chunkEnd = (chunk == nChunks - 1) ? size : (size / nChunks) * (chunk + 1);
+        auto& starts = chunkRecordStarts.at(chunk);
+        for (auto pos = chunkBegin; pos < chunkEnd; ) {
+            auto gt = static_cast<char const *>(std::memchr(data + pos, '>', chunkEnd - pos));
+            if (!gt) { break; }
+            pos = static_cast<size_t>(gt - data);
+            if (pos == 0 || data[pos-1] == '\n') { starts.emplace_back(pos); }
+            ++pos;
+        }
+    };
+    if (nChunks == 1) {
+        scanChunk(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nChunks; ++i) { threads.emplace_back(scanChunk, i); }
+        std::for_each(threads.begin(), threads.end(), [](std::thread & t) { t.join(); });
+    }
+    std::vector<FastaRecordLocation> records;
+    for (auto&& starts : chunkRecordStarts) {
+        for (auto&& pos : starts) {
+            auto newline = static_cast<char const *>(std::memchr(data + pos, '\n', size - pos));
+            size_t headerEnd = (newline) ? static_cast<size_t>(newline - data) : size;
+            size_t sequenceBegin = (newline) ? headerEnd + 1 : size;
+            while (headerEnd > pos + 1 && data[headerEnd-1] == '\r') { --headerEnd; }
+            if (records.size() > 0) { records.back().sequenceEnd = pos; }
+            records.push_back(FastaRecordLocation{pos + 1, headerEnd, sequenceBegin, size});
         }
     }
-    if ( !inputStream.eof() && inputStream.fail() ) {
-        auto msg = "[ERROR] -- FastaRepresentation -- Failed to read " + fastaFile;
+    // Anything before the first header may only be empty or comment lines
+    auto firstRecord = (records.size() > 0) ? records.front().headerBegin - 1 : size;
+    forEachSequenceLine(data, 0, firstRecord, [data, &fastaFile](size_t lineBegin, size_t) {
+        auto lineCount = std::count(data, data + lineBegin, '\n') + 1;
+        auto msg = "[ERROR] -- FastaRepresentation -- Encountered non-header, non-comment line"
+                   "that does not belong to any sequence header in '" + fastaFile +
+                   "' in line " + std::to_string(lineCount);
         throw std::runtime_error(msg);
+    });
+    // Pack each record's sequence once into pre-sized storage, records are distributed dynamically
+    std::vector<TwoBitSequence> sequences(records.size());
+    std::atomic<size_t> nextRecord{0};
+    auto copyRecords = [data, &records, &sequences, &nextRecord]() {
+        for (auto i = nextRecord++; i < records.size(); i = nextRecord++) {
+            auto& record = records.at(i);
+            size_t length = 0;
+            forEachSequenceLine(data, record.sequenceBegin, record.sequenceEnd,
+                                [&length](size_t lineBegin, size_t lineEnd) { length += lineEnd - lineBegin; });
+            auto& sequence = sequences.at(i);
+            sequence.reserve(length);
+            forEachSequenceLine(data, record.sequenceBegin, record.sequenceEnd,
+                                [data, &sequence](size_t lineBegin, size_t lineEnd) {
+                sequence.append(data + lineBegin, lineEnd - lineBegin);
+            });
+        }
+    };
+    auto nWorkers = std::min(nThreads, records.size());
+    if (nWorkers <= 1) {
+        copyRecords();
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nWorkers; ++i) { threads.emplace_back(copyRecords); }
+        std::for_each(threads.begin(), threads.end(), [](std::thread & t) { t.join(); });
+    }
+    // Store sequences in file order, repeated headers extend the existing sequence
+    headToSeq_.reserve(headToSeq_.size() + records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        auto& record = records.at(i);
+        auto head = std::string(data + record.headerBegin, data + record.headerEnd);
+        auto it = headToSeq_.find(head);
+        if (it == headToSeq_.end()) {
+            headToSeq_.emplace(head, FastaSequence(std::move(sequences.at(i)), head, filename_));
+        } else {
+            it->second.append(sequences.at(i));
+        }
     }
 }
 
 
 
-FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile)
+FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, FastaNumThreads const & nThreads)
     : artificialHeads_{}, filename_(genomeFromFilename(fastaFile.get())), headToSeq_{} {
-    readFile(fastaFile.get());
+    readFile(fastaFile.get(), nThreads.get());
 }
 
 
 
-FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSequenceLength)
+FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSequenceLength, uint64_t seed,
+                                         FastaNumThreads const & nThreads)
     : artificialHeads_{}, filename_{genomeFromFilename(fastaFile.get())}, headToSeq_{} {
-    readFile(fastaFile.get());
+    readFile(fastaFile.get(), nThreads.get());
 
     // create artificial sequence
     auto head = artificialHeader(fastaFile.get(), artificialSequenceLength);
-    std::random_device rd;
-    std::default_random_engine rng(rd());
-    std::uniform_int_distribution<uint8_t> unif(0, 3);
-    auto seq = createRandomSequence(artificialSequenceLength, unif, rng);
-    headToSeq_.insert({head, FastaSequence(seq, head, filename_)});
+    headToSeq_.insert({head, FastaSequence(createRandomSequence(artificialSequenceLength, seed, head), head, filename_)});
     artificialHeads_.insert(head);
 }
 
 
 
-FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSizeFactor, DynamicallyGenerateArtificialSequences)
+FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSizeFactor, DynamicallyGenerateArtificialSequences,
+                                         uint64_t seed, FastaNumThreads const & nThreads)
     : artificialHeads_{}, filename_{genomeFromFilename(fastaFile.get())}, headToSeq_{} {
-    readFile(fastaFile.get());
+    readFile(fastaFile.get(), nThreads.get());
 
-    std::random_device rd;
-    std::default_random_engine rng(rd());
-    std::uniform_int_distribution<uint8_t> unif(0, 3);
     FastaMapType artificialMap;
     size_t count = 0;
     for (auto&& elem : headToSeq_) {
         for (size_t i = 0; i < artificialSizeFactor; ++i) {
             auto length = elem.second.sequence().size();
             auto head = artificialHeader(fastaFile.get(), length, count);
-            auto seq = createRandomSequence(length, unif, rng);
-            artificialMap.insert({head, FastaSequence(seq, head, filename_)});
+            artificialMap.insert({head, FastaSequence(createRandomSequence(length, seed, head), head, filename_)});
             artificialHeads_.insert(head);
             ++count;
         }
@@ -112,17 +203,6 @@ FastaRepresentation::FastaRepresentation(FastaFileName const & fastaFile, size_t
 
 
 
-void FastaRepresentation::chomp(std::string& line) {
-    if (line.size() > 0) {
-        // chomp \n and \r if present ( https://en.wikipedia.org/wiki/Newline#Representation )
-        while (line.back() == '\n' || line.back() == '\r') {
-            line.pop_back();
-        }
-    }
-}
-
-
-
 void FastaRepresentation::writeArtificialSequences(std::ofstream & os) const {
     if (!os.good()) { throw std::runtime_error("[ERROR] -- FastaRepresentation::writeArtificialSequences -- Cannot write to file"); }
     for (auto&& head : artificialHeads_) {
@@ -4,17 +4,18 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <random>
 #include <string>
 #include <unordered_map>
 
 #include "Configuration.h"
 #include "IdentifierMapping.h"
 #include "StrongType.h"
+#include "TwoBitSequence.h"
 
 namespace fs = std::filesystem;
 
 //! Holds a single sequence from a fasta file, use with FastaRepresentation
+/*! The sequence is stored in a TwoBitSequence, i.e. with two bits per base */
 class FastaSequence {
 public:
     //! c'tor
@@ -29,8 +30,20 @@ public:
         : genomeName_{genomeName},
           sequence_{sequence},
           sequenceName_{sequenceName} {}
-    //! Append something to the sequence string
-    void append(std::string const & extension) {
+    //! c'tor
+    /*! \param sequence Packed sequence, moved into this object
+     * \param sequenceName Name (header) of the sequence
+     * \param genomeName Name of the genome from which the sequence is taken
+     *
+     * \details Initializes the members without copying \c sequence */
+    FastaSequence(TwoBitSequence && sequence,
+                  std::string const & sequenceName,
+                  std::string const & genomeName)
+        : genomeName_{genomeName},
+          sequence_{std::move(sequence)},
+          sequenceName_{sequenceName} {}
+    //! Append something to the sequence
+    void append(TwoBitSequence const & extension) {
         sequence_.append(extension);
     }
     //! Getter for member \c genomeName_
@@ -44,19 +57,23 @@ public:
     auto const & sequence() const { return sequence_; }
     //! Getter for member \c sequenceName_
     auto const & sequenceName() const { return sequenceName_; }
+    //! Return the sequence length
+    auto size() const { return sequence_.size(); }
+    //! Return the substring of length \c length starting at \c position
+    auto window(size_t position, size_t length) const { return sequence_.window(position, length); }
     //! Implements operator<< for an FastaSequence object for use with \c std::ofstream (use for file output)
     friend std::ofstream & operator<<(std::ofstream & out, FastaSequence const & fasta) {
         out << ">" << fasta.sequenceName_ << std::endl;
-        out << fasta.sequence_ << std::endl;
+        out << fasta.sequence_.toString() << std::endl;
         return out;
     }
     //! Implements operator<< for an FastaSequence object for use with \c std::ostream (use for std::cout)
     friend std::ostream & operator<<(std::ostream & out, FastaSequence const & fasta) {
         out << ">" << fasta.sequenceName_ << std::endl;
         if (fasta.sequence_.size() > 30) {
-            out << fasta.sequence_.substr(0,30) << "..." << std::endl;
+            out << fasta.sequence_.window(0,30) << "..." << std::endl;
         } else {
-            out << fasta.sequence_ << std::endl;
+            out << fasta.sequence_.toString() << std::endl;
         }
         return out;
     }
@@ -64,8 +81,8 @@ public:
 private:
     //! Stores the genome name
     std::string genomeName_;
-    //! Stores the sequence
-    std::string sequence_;
+    //! Stores the packed sequence
+    TwoBitSequence sequence_;
     //! Stores the sequence name
     std::string sequenceName_;
 };
@@ -75,6 +92,7 @@ private:
 // Strong Types to distinguish constructor calls
 using FastaGenomeName = NamedType<std::string, struct FastaGenomenameTag>;
 using FastaFileName = NamedType<std::string, struct FastaFileNameTag>;
+using FastaNumThreads = NamedType<size_t, struct FastaNumThreadsTag>;
 
 //! Holds contents of a fasta file, i.e. a mapping from fasta headers to the respective sequences
 class FastaRepresentation {
@@ -84,9 +102,11 @@ public:
 
     // Factory functions
     //! Return a genome name from a file path
+    /*! Strips the directories and the file extension, for compressed files also the \c .gz extension */
     static auto genomeFromFilename(std::string const & fastaFile) {
         fs::path path(fastaFile);
         auto filename = path.filename();
+        if (filename.extension() == ".gz") { filename.replace_extension(""); }
         filename.replace_extension("");
         return filename.string();
     }
@@ -103,31 +123,50 @@ public:
     FastaRepresentation(FastaGenomeName const & genomeName)
         : artificialHeads_{}, filename_{genomeName.get()}, headToSeq_{} {}
     //! c'tor (2)
-    /*! \param fastaFile Fasta file to read
+    /*! \param fastaFile Fasta file to read, may be gzip or bgzip compressed
+     * \param nThreads Number of threads used for parsing the file
      *
      * \details Reads the file from disk and stores its contents */
-    FastaRepresentation(FastaFileName const & fastaFile);
+    FastaRepresentation(FastaFileName const & fastaFile, FastaNumThreads const & nThreads = FastaNumThreads{1});
     //! c'tor (3)
     /*! \param fastaFile Fasta file to read
      * \param artificialSequenceLength Length of the artificial sequence
+     * \param seed Seed from which the artificial sequence is generated
+     * \param nThreads Number of threads used for parsing the file
      *
      * \details Reads the file from disk and stores its contents and creates
      * an additional random ACGT-sequence of length \c artificialSequenceLength */
-    FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSequenceLength);
+    FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSequenceLength, uint64_t seed,
+                        FastaNumThreads const & nThreads = FastaNumThreads{1});
     //! c'tor (4)
     /*! \param fastaFile Fasta file to read
      * \param DynamicallyGenerateArtificialSequences Tag to signal that artificial sequences are
      * to be generated dynamically to match the lenghts of the real sequences from \c fasta
+     * \param seed Seed from which the artificial sequences are generated
+     * \param nThreads Number of threads used for parsing the file
      *
      * \details Reads the file from disk and stores its contents and creates
      * additional random ACGT-sequences that match the number and respective lengths of the
      * real sequences in the file */
-    FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSizeFactor, DynamicallyGenerateArtificialSequences);
+    FastaRepresentation(FastaFileName const & fastaFile, size_t artificialSizeFactor, DynamicallyGenerateArtificialSequences,
+                        uint64_t seed, FastaNumThreads const & nThreads = FastaNumThreads{1});
     //! Add a new sequence to this FastaRepresentation
     void addSequence(std::string sequenceName, std::string const & sequence) {
         if (sequenceName.at(0) == '>') { sequenceName.erase(sequenceName.begin()); }    // remove ">"
         headToSeq_.insert({sequenceName, FastaSequence(sequence, sequenceName, filename_)});
     }
+    //! Add a new, already packed sequence to this FastaRepresentation
+    void addSequence(std::string sequenceName, TwoBitSequence sequence) {
+        if (sequenceName.at(0) == '>') { sequenceName.erase(sequenceName.begin()); }    // remove ">"
+        headToSeq_.insert({sequenceName, FastaSequence(std::move(sequence), sequenceName, filename_)});
+    }
+    //! Add a new, already packed artificial sequence to this FastaRepresentation
+    void addArtificialSequence(std::string const & sequenceName, TwoBitSequence sequence) {
+        headToSeq_.insert({sequenceName, FastaSequence(std::move(sequence), sequenceName, filename_)});
+        artificialHeads_.insert(sequenceName);
+    }
+    //! Getter for member \c artificialHeads_
+    auto const & artificialHeads() const { return artificialHeads_; }
     //! Returns the FastaSequence mapped to \c header, throws if \c header is unknown
     auto const & fastaSequence(std::string const & header) const { return headToSeq_.at(header); }
     //! Getter for member \c filename_
@@ -151,14 +190,17 @@ public:
 
 private:
     //! Factory function to create a random sequence
-    std::string createRandomSequence(size_t length,
-                                     std::uniform_int_distribution<uint8_t> & unif,
-                                     std::default_random_engine & rng);
+    /*! The sequence is virtual, its bases are generated from a seed that is derived from \c seed and \c header */
+    static TwoBitSequence createRandomSequence(size_t length, uint64_t seed, std::string const & header);
     //! Factory function to read the file content from disc
-    void readFile(std::string const & fastaFile);
-
-    //! Remove newline and carriage return at the end of \c line in place
-    void chomp(std::string& line);
+    /*! The file is memory mapped and handed to \c parseFasta(), gzip compressed files
+     * are decompressed into memory first */
+    void readFile(std::string const & fastaFile, size_t nThreads);
+    //! Parse the fasta formatted buffer \c data of length \c size
+    /*! Record boundaries are searched in parallel, then each record is packed exactly once
+     * into a TwoBitSequence that was pre-sized from the record's scanned length.
+     * \c fastaFile is only used in error messages */
+    void parseFasta(char const * data, size_t size, std::string const & fastaFile, size_t nThreads);
 
     //! Store heads of artificial sequences
     std::set<std::string> artificialHeads_;
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+
+#include "CacheFile.h"
+#include "GenomeCache.h"
+#include "MappedFile.h"
+
+
+
+namespace {
+
+//! Magic bytes at the beginning of each cache file
+constexpr char cacheMagic[8] = {'G', 'H', 'G', 'C', 'A', 'C', 'H', 'E'};
+
+//! Read header of the cache and return the stored input key
+std::string readHeader(CacheReader & reader) {
+    auto magic = reader.bytes(sizeof(cacheMagic));
+    if (std::memcmp(magic, cacheMagic, sizeof(cacheMagic)) != 0) {
+        throw std::runtime_error("[ERROR] -- GenomeCache -- Not a genome cache file");
+    }
+    if (reader.u64() != GenomeCache::formatVersion) {
+        throw std::runtime_error("[ERROR] -- GenomeCache -- Unsupported cache format version");
+    }
+    return reader.string();
+}
+
+} // namespace
+
+
+
+GenomeCache::GenomeCache(std::shared_ptr<Configuration const> config)
+    : config_{config}, path_{config->genomeCache()} {}
+
+
+
+std::string GenomeCache::inputKey() const {
+    std::string key;
+    for (auto&& file : config_->inputFiles()) {
+        auto path = fs::absolute(file);
+        key += path.string() + "\t";
+        if (fs::exists(path)) {
+            key += std::to_string(fs::file_size(path)) + "\t"
+                    + std::to_string(fs::last_write_time(path).time_since_epoch().count()) + "\n";
+        } else {
+            key += "-\n";
+        }
+    }
+    key += "genome1\t" + config_->genome1() + "\n";
+    key += "genome2\t" + config_->genome2() + "\n";
+    key += "dynamicArtificialSequences\t" + std::to_string(config_->dynamicArtificialSequences()) + "\n";
+    key += "artificialSequenceSizeFactor\t" + std::to_string(config_->artificialSequenceSizeFactor()) + "\n";
+    if (config_->dynamicArtificialSequences()) {
+        key += "artificialSequenceSeed\t" + std::to_string(config_->artificialSequenceSeed()) + "\n";
+    }
+    return key;
+}
+
+
+
+bool GenomeCache::valid() const {
+    if (!enabled() || !fs::is_regular_file(path_)) { return false; }
+    try {
+        MappedFile file(path_.string());
+        CacheReader reader(file.data(), file.size());
+        return readHeader(reader) == inputKey();
+    } catch (std::runtime_error const &) {
+        return false;
+    }
+}
+
+
+
+std::shared_ptr<FastaCollection> GenomeCache::load(IdentifierMapping & idMap,
+                                                   tsl::hopscotch_map<size_t, size_t> & sequenceLengths) const {
+    auto file = std::make_shared<MappedFile const>(path_.string());   // shared by all sequences that use it in place
+    CacheReader reader(file->data(), file->size());
+    if (readHeader(reader) != inputKey()) {
+        throw std::runtime_error("[ERROR] -- GenomeCache -- Cache " + path_.string() + " was created from different input");
+    }
+    // genomes in ID order
+    auto numGenomes = reader.u64();
+    std::vector<FastaRepresentation> genomes;
+    std::vector<std::string> genomeNames;
+    for (size_t gid = 0; gid < numGenomes; ++gid) {
+        genomeNames.emplace_back(reader.string());
+        if (idMap.queryGenomeID(genomeNames.back()) != gid) {
+            throw std::runtime_error("[ERROR] -- GenomeCache -- Inconsistent genome IDs in " + path_.string());
+        }
+        genomes.emplace_back(FastaGenomeName{genomeNames.back()});
+    }
+    // sequences in ID order
+    auto numSequences = reader.u64();
+    sequenceLengths.reserve(numSequences);
+    for (size_t sid = 0; sid < numSequences; ++sid) {
+        auto gid = reader.u64();
+        auto header = reader.string();
+        auto artificial = reader.u64();
+        auto length = reader.u64();
+        if (gid >= numGenomes || idMap.querySequenceID(header, genomeNames.at(gid)) != sid) {
+            throw std::runtime_error("[ERROR] -- GenomeCache -- Inconsistent sequence IDs in " + path_.string());
+        }
+        sequenceLengths.emplace(sid, length);
+        if (artificial) {
+            genomes.at(gid).addArtificialSequence(header, TwoBitSequence::random(length, reader.u64()));
+            continue;
+        }
+        std::vector<TwoBitSequence::ExceptionRun> exceptions(reader.u64());
+        for (auto&& run : exceptions) {
+            run.begin = reader.u64();
+            run.length = reader.u64();
+            run.character = static_cast<char>(reader.u64());
+        }
+        std::vector<TwoBitSequence::SoftmaskRun> softmasked(reader.u64());
+        for (auto&& run : softmasked) {
+            run.begin = reader.u64();
+            run.length = reader.u64();
+        }
+        auto nWords = (length + 31) / 32;
+        auto words = reinterpret_cast<uint64_t const *>(reader.bytes(nWords * sizeof(uint64_t)));
+        genomes.at(gid).addSequence(header, TwoBitSequence(length, words, file, std::move(exceptions), std::move(softmasked)));
+    }
+    auto fastaCollection = std::make_shared<FastaCollection>();
+    for (size_t gid = 0; gid < numGenomes; ++gid) {
+        fastaCollection->emplace(genomeNames.at(gid), std::move(genomes.at(gid)));
+    }
+    return fastaCollection;
+}
+
+
+
+void GenomeCache::write(FastaCollection const & fastaCollection, IdentifierMapping const & idMap) const {
+    auto tmpPath = path_;
+    tmpPath += ".tmp" + std::to_string(::getpid());
+    CacheWriter writer(tmpPath);
+    writer.bytes(cacheMagic, sizeof(cacheMagic));
+    writer.u64(formatVersion);
+    writer.string(inputKey());
+    writer.u64(idMap.numGenomes());
+    for (size_t gid = 0; gid < idMap.numGenomes(); ++gid) {
+        writer.string(idMap.queryGenomeName(gid));
+    }
+    writer.u64(idMap.numSequences());
+    for (size_t sid = 0; sid < idMap.numSequences(); ++sid) {
+        auto& tuple = idMap.querySequenceTuple(sid);
+        auto& fasta = fastaCollection.fastaRepresentation(idMap.queryGenomeName(tuple.gid));
+        auto& sequence = fasta.fastaSequence(tuple.sequence).sequence();
+        writer.u64(tuple.gid);
+        writer.string(tuple.sequence);
+        auto artificial = fasta.artificialHeads().count(tuple.sequence) > 0 && sequence.isRandom();
+        writer.u64(artificial);
+        writer.u64(sequence.size());
+        if (artificial) {
+            writer.u64(sequence.randomSeed());
+            continue;
+        }
+        writer.u64(sequence.exceptions().size());
+        for (auto&& run : sequence.exceptions()) {
+            writer.u64(run.begin);
+            writer.u64(run.length);
+            writer.u64(static_cast<uint64_t>(static_cast<unsigned char>(run.character)));
+        }
+        writer.u64(sequence.softmasked().size());
+        for (auto&& run : sequence.softmasked()) {
+            writer.u64(run.begin);
+            writer.u64(run.length);
+        }
+        for (size_t i = 0; i < sequence.wordCount(); ++i) { writer.u64(sequence.word(i)); }
+    }
+    auto success = writer.good();
+    writer.close();
+    if (!success) {
+        fs::remove(tmpPath);
+        throw std::runtime_error("[ERROR] -- GenomeCache -- Failed to write " + path_.string());
+    }
+    fs::rename(tmpPath, path_);
+}
@@ -0,0 +1,51 @@
+#ifndef GENOMECACHE_H
+#define GENOMECACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <tsl/hopscotch_map.h>
+#include "Configuration.h"
+#include "FastaCollection.h"
+#include "IdentifierMapping.h"
+
+//! Versioned binary cache of a complete set of input genomes
+/*! The cache holds the packed sequences, fasta headers, sequence lengths and the genome and
+ * sequence ID assignment. It is written after the fasta files were parsed once, later runs
+ * memory map it and use the packed sequence data in place instead of parsing the fasta files.
+ *
+ * A cache is only used if it was created from the same input, i.e. the same input files
+ * (path, size and modification time), the same \c --genome1 and \c --genome2 and the same
+ * artificial sequence options including the seed. Artificial sequences are stored as length and seed. */
+class GenomeCache {
+public:
+    //! Increment if the file layout changes
+    static constexpr uint64_t formatVersion = 2;
+
+    //! c'tor
+    /*! \param config Program configuration, provides the cache path and the input description */
+    GenomeCache(std::shared_ptr<Configuration const> config);
+    //! Return true if a cache path was set by the user
+    bool enabled() const { return !path_.empty(); }
+    //! Load the cache, fill \c idMap (must not contain more than genome1 and genome2) and \c sequenceLengths
+    /*! Throws if the cache cannot be read or belongs to a different input */
+    std::shared_ptr<FastaCollection> load(IdentifierMapping & idMap,
+                                          tsl::hopscotch_map<size_t, size_t> & sequenceLengths) const;
+    //! Return true if the cache file exists and matches the current input
+    bool valid() const;
+    //! Write \c fastaCollection with the ID assignment from \c idMap to the cache file
+    /*! The file is written under a temporary name and renamed afterwards, so concurrent runs never see a partial cache */
+    void write(FastaCollection const & fastaCollection, IdentifierMapping const & idMap) const;
+
+private:
+    //! Describe everything that determines the cached content
+    std::string inputKey() const;
+
+    //! Program configuration
+    std::shared_ptr<Configuration const> config_;
+    //! Path of the cache file
+    fs::path path_;
+};
+
+#endif // GENOMECACHE_H
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#include <zlib.h>
+#include "GzipDecompression.h"
+
+
+
+namespace {
+
+//! Read a little endian 16 bit integer
+uint32_t readUint16(unsigned char const * p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+}
+
+//! Read a little endian 32 bit integer
+uint32_t readUint32(unsigned char const * p) {
+    return readUint16(p) | (readUint16(p + 2) << 16);
+}
+
+//! Location of a single bgzip block in the compressed and in the decompressed buffer
+struct BgzfBlock {
+    size_t offset;          // start of the block in the compressed buffer
+    size_t headerSize;      // size of the gzip header including the extra field
+    size_t size;            // total size of the compressed block
+    size_t outputOffset;    // start of the block's data in the decompressed buffer
+    size_t outputSize;      // size of the decompressed block (ISIZE)
+};
+
+//! Return the total size of the bgzip block starting at \c p or zero if there is no valid BGZF header
+size_t bgzfBlockSize(unsigned char const * p, size_t remaining) {
+    // magic, CM = deflate, FLG.FEXTRA set
+    if (remaining < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || (p[3] & 4) == 0) { return 0; }
+    auto xlen = readUint16(p + 10);
+    if (remaining < 12 + static_cast<size_t>(xlen)) { return 0; }
+    // search extra subfields for 'BC' with the block size
+    for (size_t i = 12; i + 4 <= 12 + static_cast<size_t>(xlen); ) {
+        auto slen = readUint16(p + i + 2);
+        if (p[i] == 'B' && p[i+1] == 'C' && slen == 2 && i + 6 <= 12 + static_cast<size_t>(xlen)) {
+            auto blockSize = static_cast<size_t>(readUint16(p + i + 4)) + 1;
+            return (blockSize <= remaining && blockSize >= 12 + static_cast<size_t>(xlen) + 8) ? blockSize : 0;
+        }
+        i += 4 + slen;
+    }
+    return 0;
+}
+
+//! Collect all blocks of a bgzip buffer, returns an empty vector if \c data is not entirely made of BGZF blocks
+std::vector<BgzfBlock> scanBgzfBlocks(unsigned char const * data, size_t size) {
+    std::vector<BgzfBlock> blocks;
+    size_t offset = 0;
+    size_t outputOffset = 0;
+    while (offset < size) {
+        auto blockSize = bgzfBlockSize(data + offset, size - offset);
+        if (blockSize == 0) { return std::vector<BgzfBlock>{}; }
+        auto headerSize = 12 + static_cast<size_t>(readUint16(data + offset + 10));
+        auto outputSize = static_cast<size_t>(readUint32(data + offset + blockSize - 4));
+        blocks.push_back(BgzfBlock{offset, headerSize, blockSize, outputOffset, outputSize});
+        offset += blockSize;
+        outputOffset += outputSize;
+    }
+    return blocks;
+}
+
+//! Decompress bgzip \c blocks into \c output on \c nThreads threads
+void decompressBgzfBlocks(unsigned char const * data, std::vector<BgzfBlock> const & blocks,
+                          std::vector<char> & output, size_t nThreads, std::string const & filename) {
+    std::atomic<size_t> nextBlock{0};
+    std::atomic<bool> failed{false};
+    auto worker = [data, &blocks, &output, &nextBlock, &failed]() {
+        z_stream stream{};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { failed = true; return; }  // raw deflate data
+        for (auto i = nextBlock++; i < blocks.size() && !failed; i = nextBlock++) {
+            auto& block = blocks[i];
+            auto out = reinterpret_cast<unsigned char *>(output.data() + block.outputOffset);
+            inflateReset(&stream);
+            stream.next_in = const_cast<unsigned char *>(data + block.offset + block.headerSize);
+            stream.avail_in = static_cast<uInt>(block.size - block.headerSize - 8);
+            stream.next_out = out;
+            stream.avail_out = static_cast<uInt>(block.outputSize);
+            auto status = inflate(&stream, Z_FINISH);
+            auto expectedCrc = readUint32(data + block.offset + block.size - 8);
+            if (status != Z_STREAM_END || stream.total_out != block.outputSize
+                    || crc32(crc32(0L, Z_NULL, 0), out, static_cast<uInt>(block.outputSize)) != expectedCrc) {
+                failed = true;
+            }
+        }
+        inflateEnd(&stream);
+    };
+    nThreads = std::max<size_t>(1, std::min(nThreads, blocks.size()));
+    if (nThreads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nThreads; ++i) { threads.emplace_back(worker); }
+        std::for_each(threads.begin(), threads.end(), [](std::thread & t) { t.join(); });
+    }
+    if (failed) { throw std::runtime_error("[ERROR] -- decompressGzip -- Corrupt bgzip block in " + filename); }
+}
+
+//! Sequentially decompress a (possibly multi-member) gzip buffer
+std::vector<char> decompressGzipStream(unsigned char const * data, size_t size, std::string const & filename) {
+    std::vector<char> output;
+    // ISIZE of the last member (size modulo 2^32) is a good hint for single member files
+    output.reserve(std::max(static_cast<size_t>(readUint32(data + size - 4)), 2 * size));
+    z_stream stream{};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {   // expect gzip header
+        throw std::runtime_error("[ERROR] -- decompressGzip -- Failed to initialize zlib");
+    }
+    stream.next_in = const_cast<unsigned char *>(data);
+    size_t remaining = size;
+    int status = Z_OK;
+    size_t const chunk = 1 << 20;
+    while (true) {
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(remaining, UINT32_MAX));
+        auto availIn = stream.avail_in;
+        auto outputSize = output.size();
+        output.resize(outputSize + chunk);
+        stream.next_out = reinterpret_cast<unsigned char *>(output.data() + outputSize);
+        stream.avail_out = static_cast<uInt>(chunk);
+        status = inflate(&stream, Z_NO_FLUSH);
+        output.resize(output.size() - stream.avail_out);
+        remaining -= availIn - stream.avail_in;
+        if (status == Z_STREAM_END) {
+            if (remaining == 0) { break; }
+            inflateReset(&stream);  // next gzip member
+        } else if (status != Z_OK && !(status == Z_BUF_ERROR && remaining > 0)) {
+            inflateEnd(&stream);
+            throw std::runtime_error("[ERROR] -- decompressGzip -- Corrupt or truncated gzip file " + filename);
+        } else if (remaining == 0 && stream.avail_out > 0) {
+            inflateEnd(&stream);
+            throw std::runtime_error("[ERROR] -- decompressGzip -- Truncated gzip file " + filename);
+        }
+    }
+    inflateEnd(&stream);
+    return output;
+}
+
+} // namespace
+
+
+
+bool isGzipCompressed(char const * data, size_t size) {
+    return size >= 2
+            && static_cast<unsigned char>(data[0]) == 0x1f
+            && static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+
+
+std::vector<char> decompressGzip(char const * data, size_t size, size_t nThreads, std::string const & filename) {
+    auto udata = reinterpret_cast<unsigned char const *>(data);
+    if (size < 18) { throw std::runtime_error("[ERROR] -- decompressGzip -- Truncated gzip file " + filename); }
+    auto blocks = scanBgzfBlocks(udata, size);
+    if (blocks.size() == 0) { return decompressGzipStream(udata, size, filename); }
+    std::vector<char> output(blocks.back().outputOffset + blocks.back().outputSize);
+    decompressBgzfBlocks(udata, blocks, output, nThreads, filename);
+    return output;
+}
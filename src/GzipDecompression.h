@@ -0,0 +1,23 @@
+#ifndef GZIPDECOMPRESSION_H
+#define GZIPDECOMPRESSION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! Check if \c data starts with the gzip magic bytes
+bool isGzipCompressed(char const * data, size_t size);
+
+//! Decompress a gzip compressed buffer completely into memory
+/*! \param data Compressed buffer
+ * \param size Length of \c data in bytes
+ * \param nThreads Number of threads used to decompress bgzip blocks
+ * \param filename Name of the input file, only used in error messages
+ *
+ * \details If the buffer consists of bgzip (BGZF) blocks, these are decompressed independently
+ * on \c nThreads threads straight into their final place in the output buffer, which is pre-sized
+ * from the block footers. Other gzip files (possibly with multiple members) are decompressed
+ * sequentially. Throws if the input is corrupt or truncated. */
+std::vector<char> decompressGzip(char const * data, size_t size, size_t nThreads, std::string const & filename);
+
+#endif // GZIPDECOMPRESSION_H
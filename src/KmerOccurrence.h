@@ -1,11 +1,15 @@
 #ifndef KMEROCCURRENCE_H
 #define KMEROCCURRENCE_H
 
+#include <algorithm>
 #include <bitset>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "mabl3/JsonStream.h"
 #include "nlohmann/json.hpp"
@@ -13,35 +17,112 @@
 #include "FastaCollection.h"
 #include "IdentifierMapping.h"
 #include "ReverseComplement.h"
+#include "StrongType.h"
+
+//! Signals that the lexicographically bigger of k-mer and reverse complement is the k-mer itself
+using BiggerKmerStored = NamedType<bool, struct BiggerKmerStoredTag>;
 
 //! Stores the occurrence of a k-mer in 8 byte
 class KmerOccurrence {
 public:
-    //! Constructor
-    KmerOccurrence(uint8_t genomeID, uint32_t sequenceID, size_t position, bool reverseStrand, std::string const & kmer)
-          // initialize bitvector with ..00 gggg bits
-        : data_{genomeID} {
-        if (genomeID > 0xf) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Too many input genomes"); }
-        if (sequenceID > 0x3ffff) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Too many input sequences"); }
-        if (position > 0xffffffffff) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Input sequence too long"); }
-
-        // set remaining bits
-        if (reverseStrand) { data_.set(4); }
-        if (kmer > reverseComplement(kmer)) { data_.set(5); }
-
-        std::bitset<64> sequenceBits(sequenceID);   //      ..00 00ss ssss ssss ssss ssss
-        sequenceBits <<= 6;                         // ..00 ssss ssss ssss ssss ss00 0000
-        data_ |= sequenceBits;
+    //! Widths of the genome, sequence and position fields
+    /*! The reverse strand and k-mer bits always occupy two bits between genome and sequence ID,
+     * the three fields share the remaining 62 bits. The layout is process-wide and must be set
+     * before the first KmerOccurrence is created (see \c setLayout()) */
+    struct Layout {
+        size_t genomeBits;
+        size_t sequenceBits;
+        size_t positionBits;
+        //! First bit of the sequence ID
+        size_t sequenceShift() const { return genomeBits + 2; }
+        //! First bit of the position
+        size_t positionShift() const { return genomeBits + 2 + sequenceBits; }
+        //! Largest genome ID that can be stored
+        uint64_t maxGenomeID() const { return lowMask(genomeBits); }
+        //! Largest sequence ID that can be stored
+        uint64_t maxSequenceID() const { return lowMask(sequenceBits); }
+        //! Largest position or tile ID that can be stored
+        uint64_t maxPosition() const { return lowMask(positionBits); }
+        bool operator==(Layout const & rhs) const {
+            return genomeBits == rhs.genomeBits && sequenceBits == rhs.sequenceBits && positionBits == rhs.positionBits;
+        }
+        //! Implements operator<< for a Layout object for use with \c std::ostream
+        friend std::ostream & operator<<(std::ostream & out, Layout const & layout) {
+            out << layout.genomeBits << "/" << layout.sequenceBits << "/" << layout.positionBits;
+            return out;
+        }
+    };
+    //! Default layout: 16 genomes, 262,144 sequences, positions up to 2^40 - 1
+    static constexpr Layout compactLayout() { return Layout{4, 18, 40}; }
+    //! Returns the smallest deviation from \c compactLayout() that can store the input
+    /*! \param numGenomes Number of genome IDs in use
+     * \param numSequences Number of sequence IDs in use
+     * \param maxSequenceLength Longest input sequence
+     *
+     * \details Returns \c compactLayout() if the input fits, otherwise genome and sequence fields are
+     * grown to the minimum width and the position field gets the rest. Position fields need one spare
+     * bit for the sign of a \c Tiledistance. Throws if no split of the 62 bits can store the input */
+    static Layout fitLayout(size_t numGenomes, size_t numSequences, size_t maxSequenceLength) {
+        auto layout = compactLayout();
+        auto positionBits = bitsFor(maxSequenceLength) + 1;
+        if (numGenomes <= layout.maxGenomeID() + 1
+                && numSequences <= layout.maxSequenceID() + 1
+                && positionBits <= layout.positionBits) {
+            return layout;
+        }
+        layout.genomeBits = std::max<size_t>(bitsFor(numGenomes ? numGenomes - 1 : 0), 1);
+        layout.sequenceBits = std::max<size_t>(bitsFor(numSequences ? numSequences - 1 : 0), 1);
+        if (layout.genomeBits > 8) { throw std::runtime_error("[ERROR] -- KmerOccurrence::fitLayout -- Too many input genomes"); }
+        if (layout.sequenceBits > 32) { throw std::runtime_error("[ERROR] -- KmerOccurrence::fitLayout -- Too many input sequences"); }
+        if (layout.genomeBits + layout.sequenceBits + positionBits > 62) {
+            throw std::runtime_error("[ERROR] -- KmerOccurrence::fitLayout -- Input too large for 64 bit occurrences ("
+                                     + std::to_string(numGenomes) + " genomes, " + std::to_string(numSequences)
+                                     + " sequences, longest sequence " + std::to_string(maxSequenceLength) + ")");
+        }
+        layout.positionBits = 62 - layout.genomeBits - layout.sequenceBits;
+        return layout;
+    }
+    //! Getter for the current layout
+    static Layout const & layout() { return layoutRef(); }
+    //! Set the process-wide layout, existing KmerOccurrence objects become invalid if it changes
+    static void setLayout(Layout layout) {
+        if (layout.genomeBits + layout.sequenceBits + layout.positionBits > 62
+                || layout.genomeBits > 8 || layout.sequenceBits > 32) {
+            throw std::runtime_error("[ERROR] -- KmerOccurrence::setLayout -- Invalid layout");
+        }
+        layoutRef() = layout;
+    }
 
-        std::bitset<64> positionBits(position);     // same principle as above
-        positionBits <<= 24;
-        data_ |= positionBits;
+    //! Constructor (1)
+    KmerOccurrence(uint8_t genomeID, uint32_t sequenceID, size_t position, bool reverseStrand, std::string const & kmer)
+        : KmerOccurrence(genomeID, sequenceID, position, reverseStrand, BiggerKmerStored{kmer > reverseComplement(kmer)}) {}
+    //! Constructor (2)
+    /*! Use if it is already known which of k-mer and reverse complement is bigger, e.g. from a RollingKmerWindow */
+    KmerOccurrence(uint8_t genomeID, uint32_t sequenceID, size_t position, bool reverseStrand, BiggerKmerStored biggerKmer)
+        : data_{} {
+        auto const & l = layout();
+        if (genomeID > l.maxGenomeID()) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Too many input genomes"); }
+        if (sequenceID > l.maxSequenceID()) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Too many input sequences"); }
+        if (position > l.maxPosition()) { throw std::runtime_error("[ERROR] -- KmerOccurrence -- Input sequence too long"); }
+        data_ = std::bitset<64>{uint64_t{genomeID}                      // ..00 gggg
+                                | (uint64_t{reverseStrand} << l.genomeBits)
+                                | (uint64_t{biggerKmer.get()} << (l.genomeBits + 1))
+                                | (uint64_t{sequenceID} << l.sequenceShift())
+                                | (uint64_t{position} << l.positionShift())};
+    }
+    //! Restore an occurrence from \c data().to_ullong(), e.g. after writing it to a file
+    static KmerOccurrence fromBits(uint64_t bits) {
+        KmerOccurrence occurrence(0, 0, 0, false, BiggerKmerStored{false});
+        occurrence.data_ = std::bitset<64>{bits};
+        return occurrence;
     }
     //! KmerOccurrence stores the first position of a k-mer, use this to calculate the central position
     /*! If the k-mer length is even, the center is the left/smaller of both possibilities */
     static size_t centerPosition(size_t firstPosition, size_t k) {
         return firstPosition + static_cast<size_t>(std::ceil(static_cast<double>(k)/2.)) - 1;
     }
+    //! Getter for the bit that signals if the bigger of k-mer and reverse complement is stored
+    bool biggerKmerStored() const { return data_.test(layout().genomeBits + 1); }
     //! getter for data member
     auto const & data() const { return data_; }
     //! Differs from KmerOccurrence::operator==() as k-mer string is ignored
@@ -58,7 +139,7 @@ public:
                               IdentifierMapping const & idMap,
                               size_t k) const {
         auto & fastaSequence = fastas.fastaSequence(sequenceID_(), idMap);
-        auto kmer = fastaSequence.sequence().substr(this->position(), k);
+        auto kmer = fastaSequence.window(this->position(), k);
         return storedKmer(kmer);
     }
     //! Implements operator== by checking if all bits are equal
@@ -70,16 +151,16 @@ public:
         // tuples have the desired comparison logic
         std::tuple<uint8_t, uint32_t, size_t, bool, bool> lhsTuple{genome(), sequence(),
                                                                    position(), reverse(),
-                                                                   data_.test(5)};
+                                                                   biggerKmerStored()};
         std::tuple<uint8_t, uint32_t, size_t, bool, bool> rhsTuple{rhs.genome(), rhs.sequence(),
                                                                    rhs.position(), rhs.reverse(),
-                                                                   rhs.data_.test(5)};
+                                                                   rhs.biggerKmerStored()};
         return lhsTuple < rhsTuple;
     }
     //! Implements operator<< for a KmerOccurrence object for use with \c std::ostream
     friend std::ostream & operator<<(std::ostream & out, KmerOccurrence const & occ) {
         out << "(" << static_cast<uint>(occ.genome()) << ", " << occ.sequence() << ", "
-            << occ.position() << ", " << occ.reverse() << "){" << occ.data_.test(5) << "}";
+            << occ.position() << ", " << occ.reverse() << "){" << occ.biggerKmerStored() << "}";
         return out;
     }
     //! Getter for the position
@@ -91,7 +172,7 @@ public:
     //! Returns the true k-mer at this occurrence
     std::string storedKmer(std::string const & queryKmer) const {
         auto rc = reverseComplement(queryKmer);
-        return (data_.test(5))
+        return (biggerKmerStored())
                 ? std::max(queryKmer, rc)
                 : std::min(queryKmer, rc);
     }
@@ -108,43 +189,51 @@ public:
     }
 
 private:
+    //! Number of bits needed to store \c value
+    static size_t bitsFor(uint64_t value) {
+        size_t bits = 0;
+        for (; value; value >>= 1) { ++bits; }
+        return bits;
+    }
+    //! Returns a mask with the lowest \c bits bits set
+    static constexpr uint64_t lowMask(size_t bits) { return (bits >= 64) ? ~uint64_t{0} : ((uint64_t{1} << bits) - 1); }
+    //! Storage of the process-wide layout
+    static Layout & layoutRef() {
+        static Layout layout = compactLayout();
+        return layout;
+    }
     //! Getter for Genome ID
     uint8_t genomeID_() const {
-        std::bitset<64> genomeMask{0xf}; // ..00 1111
-        auto idBits = data_ & genomeMask;
-        return idBits.to_ulong();
+        return static_cast<uint8_t>(data_.to_ullong() & layout().maxGenomeID());
     }
     //! Getter for Position (e.g. absolute position or tile ID)
     size_t position_() const {
-        std::bitset<64> genomeMask{0xffffffffff};   // ..00 (1111) (eleven times)
-        auto positionBits = data_ >> 24;            // shift s, s, r and g bits away
-        positionBits &= genomeMask;
-        return positionBits.to_ullong();
+        auto const & l = layout();
+        return (data_.to_ullong() >> l.positionShift()) & l.maxPosition();
     }
     //! Getter for Strand information
     bool reverseStrand_() const {
-        return data_.test(4);   // position from right to left
+        return data_.test(layout().genomeBits);   // position from right to left
     }
     //! Getter for Sequence ID
     uint32_t sequenceID_() const {
-        std::bitset<64> genomeMask{0x3ffff}; // ..00 0011 1111 1111 1111 1111
-        auto idBits = data_ >> 6;           // shift 'cr gggg' bits away
-        idBits &= genomeMask;
-        return idBits.to_ulong();
+        auto const & l = layout();
+        return static_cast<uint32_t>((data_.to_ullong() >> l.sequenceShift()) & l.maxSequenceID());
     }
 
     //! Stores the data in a bitfield of size 64 to avoid memory waste via padding
-    /*! Bitset layout:
+    /*! Bitset layout (\c compactLayout(), other layouts only move the field borders):
      * pppp pppp pppp pppp pppp pppp pppp pppp
      * pppp pppp ssss ssss ssss ssss sscr gggg
      * where \c p are the bits for position, \c s are the bits for sequence id,
      * \c c is a bit that indicates if the lexicographically bigger of kmer and reverse complement
      * is stored (both are treated as the same k-mer and need to be separated this way),
      * \c r is the bit for reverse strand information and \c g are the bits for genome id
-     * This implies that this class represent at most
+     * With the default layout, this class represents at most
      *   16 different genomes
-     *   262,143 different sequences (of all genomes!)
-     *   Sequence lengths or tile IDs up to ‭1,099,511,627,775‬ */
+     *   262,144 different sequences (of all genomes!)
+     *   Sequence lengths or tile IDs up to ‭1,099,511,627,775‬
+     * Larger inputs trade position bits for genome and sequence bits (see \c fitLayout()) */
     std::bitset<64> data_;
 };
 
@@ -181,4 +270,31 @@ struct KmerOccurrencePositionEqual {
     }
 };
 
+
+
+//! Read-only view on contiguously stored KmerOccurrence s, e.g. an occurrence vector or a slice of a SeedIndex
+class OccurrenceRange {
+public:
+    //! c'tor (1)
+    /*! \details Creates an empty range */
+    OccurrenceRange() : begin_{nullptr}, end_{nullptr} {}
+    //! c'tor (2)
+    /*! \param begin First occurrence
+     * \param end One past the last occurrence */
+    OccurrenceRange(KmerOccurrence const * begin, KmerOccurrence const * end) : begin_{begin}, end_{end} {}
+    //! c'tor (3)
+    /*! \details Views all elements of \c occurrences, which must outlive the range */
+    OccurrenceRange(std::vector<KmerOccurrence> const & occurrences)
+        : begin_{occurrences.data()}, end_{occurrences.data() + occurrences.size()} {}
+    KmerOccurrence const * begin() const { return begin_; }
+    KmerOccurrence const * end() const { return end_; }
+    bool empty() const { return begin_ == end_; }
+    size_t size() const { return static_cast<size_t>(end_ - begin_); }
+    KmerOccurrence const & operator[](size_t i) const { return begin_[i]; }
+
+private:
+    KmerOccurrence const * begin_;
+    KmerOccurrence const * end_;
+};
+
 #endif // KMEROCCURRENCE_H
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "prettyprint.hpp"
+#include "tsl/hopscotch_map.h"
 #include "CustomHashGeneral.h"
 #include "KmerOccurrence.h"
 
@@ -43,6 +44,27 @@ void groupOverlappingSeeds(MatchContainer & sortedMatches) {
 
 
 
+//! Express the occurrences of a new link relative to the strand of its first occurrence
+/*! With canonical seeds, an occurrence stores its forward position and whether the seed was found on the
+ * reverse strand. Occurrences on the other strand than the first one get reverse strand coordinates, i.e.
+ * their position on the reverse complement of the sequence, so that matches between opposite strands
+ * lie on a diagonal as well. Afterwards, the first occurrence is always on the forward strand */
+inline void orientOccurrences(std::vector<KmerOccurrence> & occurrences, size_t span,
+                              tsl::hopscotch_map<size_t, size_t> const & sequenceLengths) {
+    auto anyReverse = std::any_of(occurrences.begin(), occurrences.end(),
+                                  [](KmerOccurrence const & occ) { return occ.reverse(); });
+    if (!anyReverse) { return; }
+    auto firstReverse = occurrences.front().reverse();
+    for (auto&& occ : occurrences) {
+        auto reverse = occ.reverse() != firstReverse;
+        auto position = occ.position();
+        if (reverse) { position = sequenceLengths.at(occ.sequence()) - position - span; }
+        occ = KmerOccurrence(occ.genome(), occ.sequence(), position, reverse, BiggerKmerStored{occ.biggerKmerStored()});
+    }
+}
+
+
+
 //! compute chunk ID from position sum
 inline size_t chunkID_impl(size_t sum, size_t chunksize) {
     return static_cast<size_t>(std::floor(static_cast<long double>(sum) / static_cast<long double>(chunksize)));
@@ -25,7 +25,7 @@ void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::addLink(LinkType link) {
 
 
 template<typename LinkType, typename LinkTypeHash, typename LinkTypeEqual>
-void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createLinks(std::vector<KmerOccurrence> const & occurrences, size_t span) {
+void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createLinks(OccurrenceRange occurrences, size_t span) {
     auto processingFunction = [this, span](std::vector<tsl::hopscotch_map<size_t, // seqID
                                                                           tsl::hopscotch_set<KmerOccurrence,
                                                                                              KmerOccurrencePositionHash,
@@ -55,11 +55,13 @@ void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createLinks(std::vector<Kme
             }
             for (auto linkID : linkIDs) {
                 auto tiles = cartesianProductByID(linkID, allOccs);
+                orientTiles(tiles, span);
                 addLink(LinkType(tiles, span));   // add link to linkset and increase link count
             }
         } else {
             for (size_t id = 0; id < nPossible; ++id) {
                 auto tiles = cartesianProductByID(id, allOccs);
+                orientTiles(tiles, span);
                 addLink(LinkType(tiles, span));   // add link to linkset and increase link count
             }
         }
@@ -72,7 +74,7 @@ void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createLinks(std::vector<Kme
 
 
 template<typename LinkType, typename LinkTypeHash, typename LinkTypeEqual>
-void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createRelevantLinks(std::vector<KmerOccurrence> const & occurrences, size_t span,
+void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createRelevantLinks(OccurrenceRange occurrences, size_t span,
                                                                          tsl::hopscotch_set<std::shared_ptr<Cube const>, CubePtrHash, CubePtrEqual> const & relevantCubes) {
     auto processingFunction = [this,
                                &relevantCubes,
@@ -119,6 +121,7 @@ void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createRelevantLinks(std::ve
             }
             for (auto linkID : linkIDVector) {
                 auto tiles = cartesianProductByID(linkID, allOccs);
+                orientTiles(tiles, span);
                 LinkPtr link(tiles, span);
                 if (relevantCubes.find(std::make_shared<Cube>(*link, config_->tileSize())) != relevantCubes.end()) {
                     addLinkExt(*this, link);
@@ -143,7 +146,7 @@ void Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::createRelevantLinks(std::ve
 
 
 template<typename LinkType, typename LinkTypeHash, typename LinkTypeEqual>
-bool Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::processOccurrences(std::vector<KmerOccurrence> const & occurrences,
+bool Linkset<LinkType, LinkTypeHash, LinkTypeEqual>::processOccurrences(OccurrenceRange occurrences,
                                                                         std::function<void(std::vector<tsl::hopscotch_map<size_t, // seqID
                                                                                                                           tsl::hopscotch_set<KmerOccurrence,
                                                                                                                                              KmerOccurrencePositionHash,
@@ -10,6 +10,7 @@
 #include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <set>
@@ -30,6 +31,7 @@
 #include "IdentifierMapping.h"
 #include "Link.h"
 #include "MemoryMonitor.h"
+#include "Prefetch.h"
 #include "SeedMap.h"
 
 using namespace mabl3;
@@ -72,17 +74,22 @@ public:
     /*! \param config Shared ptr to global configuration
      * \param indetifierMapping Instance of IdentifierMapping that already
      * knows about all IDs
+     * \param sequenceLengths Lengths of all sequences by ID, needed to orient Links from canonical seeds
      * \param parallel Perform certain tasks in parallel if true
      *
      * \details Creates an empty Linkset with a user-defined IdentifierMapping
      * member that must already know all names of input genomes and sequences. */
     explicit Linkset(std::shared_ptr<Configuration const> config,
                      std::shared_ptr<IdentifierMapping const> identifierMapping,
+                     std::shared_ptr<tsl::hopscotch_map<size_t, size_t> const> sequenceLengths,
                      bool parallel = true)
         : config_{config},
           idMapping_{identifierMapping},
           linkset_{}, numDiscarded_{0},
-          parallel_{parallel && config->nThreads() > 1}, rd_{} {}
+          parallel_{parallel && config->nThreads() > 1}, rd_{},
+          sequenceLengths_{sequenceLengths} {
+        if (config_->canonicalSeeds() && !sequenceLengths_) { throw std::runtime_error("[ERROR] -- Linkset -- Sequence lengths needed for canonical seeds"); }
+    }
     //! Add a Link into the Linkset or increase counter for this Link
     void addLink(LinkType link);
     //! Applies M4, works only in 2D Case, with more dimensions only first two occurrences of Links used, may lead to UB
@@ -112,7 +119,7 @@ public:
     //! Getter for member \c config_
     auto config() const { return config_; }
     //! Count number of valid links that can be created from this vector of occurrences
-    size_t countLinks(std::vector<KmerOccurrence> const & occurrences) const {
+    size_t countLinks(OccurrenceRange occurrences) const {
         size_t count = 0;
         auto processingFunction = [this, &count](std::vector<tsl::hopscotch_map<size_t, // seqID
                                                                                 tsl::hopscotch_set<KmerOccurrence,
@@ -131,22 +138,57 @@ public:
         return count;
     }
     //! Create a Link in the Linkset from a vector of occurrences
-    void createLinks(std::vector<KmerOccurrence> const & occurrences, size_t span);
+    void createLinks(OccurrenceRange occurrences, size_t span);
     //! Create all Link s from a SeedMap
+    /*! With '--parallel-link-creation', the partitions of the SeedMap are processed by different threads,
+     * see \c createLinksFromPartitions() */
     template<typename TwoBitSeedDataType>
     void createLinks(SeedMap<TwoBitSeedDataType> const & seedMap, bool silent = false) {
-        // parallel does slow things down, so use single thread
-        ProgressBar pb(seedMap.size(), silent || config_->verbose() < 2);
-        for (auto&& elem : seedMap.seedMap()) {
-            for (size_t maskID = 0; maskID < config_->seedSetSize(); ++maskID) {
-                auto& occurrenceVector = elem.second.at(maskID);
-                createLinks(occurrenceVector, config_->maskCollection()->span(maskID));
+        auto processSeed = [](Linkset & linkset, TwoBitKmer<TwoBitSeedDataType> const &, SeedOccurrences const & occurrences) {
+            for (size_t maskID = 0; maskID < linkset.config_->seedSetSize(); ++maskID) {
+                linkset.createLinks(occurrences.at(maskID), linkset.config_->maskCollection()->span(maskID));
             }
-            ++pb;
-        }
-        pb.finish();
+        };
+        createLinksFromSeeds(seedMap, processSeed, silent);
+    }
+    //! Create all Link s between the seeds of a SeedMap and a persisted SeedIndex ('--seed-index')
+    /*! Only seeds that are present in both can create Link s, their occurrences are joined for each mask.
+     * The seeds of each partition are looked up in blocks with the batched SeedIndex::find() */
+    template<typename TwoBitSeedDataType>
+    void createLinks(SeedMap<TwoBitSeedDataType> const & seedMap,
+                     SeedIndex<TwoBitSeedDataType> const & persistedIndex, bool silent = false) {
+        auto processPartition = [&persistedIndex, &seedMap](Linkset & linkset, size_t p) {
+            std::vector<TwoBitKmer<TwoBitSeedDataType>> seeds;
+            std::vector<SeedOccurrences> occurrences;
+            std::vector<SeedOccurrences> persisted;
+            std::vector<KmerOccurrence> joined;
+            auto processBlock = [&]() {
+                persistedIndex.find(seeds, persisted);
+                for (size_t i = 0; i < seeds.size(); ++i) {
+                    if (!persisted[i].found()) { continue; }
+                    for (size_t maskID = 0; maskID < linkset.config_->seedSetSize(); ++maskID) {
+                        auto persistedRange = persisted[i].at(maskID);
+                        auto range = occurrences[i].at(maskID);
+                        if (persistedRange.empty() || range.empty()) { continue; }
+                        joined.assign(persistedRange.begin(), persistedRange.end());
+                        joined.insert(joined.end(), range.begin(), range.end());
+                        linkset.createLinks(joined, linkset.config_->maskCollection()->span(maskID));
+                    }
+                }
+                seeds.clear();
+                occurrences.clear();
+            };
+            seedMap.forEachSeedInPartition(p, [&](TwoBitKmer<TwoBitSeedDataType> const & seed, SeedOccurrences const & seedOccurrences) {
+                seeds.emplace_back(seed);
+                occurrences.emplace_back(seedOccurrences);
+                if (seeds.size() == prefetchBlockSize) { processBlock(); }
+            });
+            processBlock();
+        };
+        createLinksFromPartitions(seedMap, processPartition, silent);
     }
     //! Create Link s from a single reference sequence vs. the other genomes
+    /*! Visits the seeds of \c sid by their slots in \c seedMap in prefetched blocks, see SeedMap::collectReferenceSlots() */
     template<typename TwoBitSeedDataType>
     void createLinks(SeedMap<TwoBitSeedDataType> const & seedMap, size_t sid) {
         if (seedMap.referenceSeedMap().referenceSeedMap().find(sid) == seedMap.referenceSeedMap().referenceSeedMap().end()) {
@@ -155,13 +197,20 @@ public:
         if (idMapping_->sequenceIDToTuple().at(sid).gid != 0) {
             throw std::runtime_error("[ERROR] -- Linkset::createLinks -- sid not from reference genome");
         }
-        for (auto&& seed : seedMap.referenceSeedMap().referenceSeedMap().at(sid)) {
-            for (size_t maskID = 0; maskID < config_->seedSetSize(); ++maskID) {
-                std::vector<KmerOccurrence> occurrenceVector{};
-                for (auto&& occ : seedMap.seedMap().at(seed).at(maskID)) {
-                    if (occ.genome() > 0 || occ.sequence() == sid) { occurrenceVector.emplace_back(occ); }
+        auto& slots = seedMap.referenceSeedMap().referenceSeedMap().at(sid);
+        std::vector<SeedOccurrences> block;
+        for (size_t first = 0; first < slots.size(); first += prefetchBlockSize) {
+            auto last = std::min(slots.size(), first + prefetchBlockSize);
+            seedMap.occurrencesOfSlots(slots.begin() + static_cast<std::ptrdiff_t>(first),
+                                       slots.begin() + static_cast<std::ptrdiff_t>(last), block);
+            for (auto&& occurrences : block) {
+                for (size_t maskID = 0; maskID < config_->seedSetSize(); ++maskID) {
+                    std::vector<KmerOccurrence> occurrenceVector{};
+                    for (auto&& occ : occurrences.at(maskID)) {
+                        if (occ.genome() > 0 || occ.sequence() == sid) { occurrenceVector.emplace_back(occ); }
+                    }
+                    createLinks(occurrenceVector, config_->maskCollection()->span(maskID));
                 }
-                createLinks(occurrenceVector, config_->maskCollection()->span(maskID));
             }
         }
     }
@@ -258,18 +307,18 @@ public:
                      tsl::hopscotch_set<std::shared_ptr<Cube const>, CubePtrHash, CubePtrEqual> const & relevantCubes,
                      bool silent = false) {
         ProgressBar pb(seedMap.size(), silent || config_->verbose() < 2);
-        for (auto&& elem : seedMap.seedMap()) {
+        seedMap.forEachSeed([this, &pb, &relevantCubes](TwoBitKmer<TwoBitSeedDataType> const &, SeedOccurrences const & occurrences) {
             for (size_t maskID = 0; maskID < config_->seedSetSize(); ++maskID) {
                 auto span = config_->maskCollection()->span(maskID);
-                auto& occurrenceVector = elem.second.at(maskID);
-                if (occurrenceVector.size()) { createRelevantLinks(occurrenceVector, span, relevantCubes); }
+                auto occurrenceRange = occurrences.at(maskID);
+                if (occurrenceRange.size()) { createRelevantLinks(occurrenceRange, span, relevantCubes); }
             }
             ++pb;
-        }
+        });
         pb.finish();
     }
     //! Create a Link in the Linkset from a vector of occurrences
-    void createRelevantLinks(std::vector<KmerOccurrence> const & occurrences, size_t span,
+    void createRelevantLinks(OccurrenceRange occurrences, size_t span,
                              tsl::hopscotch_set<std::shared_ptr<Cube const>, CubePtrHash, CubePtrEqual> const & relevantCubes);
     //! Group Links that overlap on the same diagonal
     void groupOverlappingLinks() {
@@ -309,6 +358,7 @@ public:
         idMapping_ = other.idMapping_;
         linkset_ = std::move(other.linkset_);
         parallel_ = other.parallel_;
+        sequenceLengths_ = other.sequenceLengths_;
         return *this;
     }
     //! Implements operator== for Linkset
@@ -336,7 +386,7 @@ public:
         out << "Discarded " << numDiscarded_ << " seeds" << std::endl;
         return out;
     }
-    bool processOccurrences(std::vector<KmerOccurrence> const & occurrenceVector,
+    bool processOccurrences(OccurrenceRange occurrences,
                             std::function<void(std::vector<tsl::hopscotch_map<size_t, // seqID
                                                                               tsl::hopscotch_set<KmerOccurrence,
                                                                                                  KmerOccurrencePositionHash,
@@ -347,6 +397,70 @@ public:
     size_t size() const { return linkset_.size(); }
 
 private:
+    //! Create Link s from each seed of a SeedMap with \c processSeed(linkset, seed, occurrences)
+    template<typename TwoBitSeedDataType, typename F>
+    void createLinksFromSeeds(SeedMap<TwoBitSeedDataType> const & seedMap, F const & processSeed, bool silent) {
+        auto processPartition = [&processSeed, &seedMap](Linkset & linkset, size_t p) {
+            seedMap.forEachSeedInPartition(p, [&linkset, &processSeed](TwoBitKmer<TwoBitSeedDataType> const & seed,
+                                                                      SeedOccurrences const & occurrences) {
+                processSeed(linkset, seed, occurrences);
+            });
+        };
+        createLinksFromPartitions(seedMap, processPartition, silent);
+    }
+    //! Create Link s from each partition of a SeedMap with \c processPartition(linkset, partition)
+    /*! With '--parallel-link-creation', the partitions are processed by different threads, each into
+     * its own Linkset, which are merged with \c mergeCounts() afterwards */
+    template<typename TwoBitSeedDataType, typename F>
+    void createLinksFromPartitions(SeedMap<TwoBitSeedDataType> const & seedMap, F const & processPartition, bool silent) {
+        std::vector<size_t> partitions(seedMap.numPartitions());
+        std::iota(partitions.begin(), partitions.end(), 0);
+        if (parallel_ && config_->parallelLinkCreation() && seedMap.numPartitions() > 1) {
+            ParallelProgressBar pb(partitions.size(), silent || config_->verbose() < 2);
+            std::mutex mutex{};
+            auto callback = [this, &mutex, &pb, &processPartition](std::vector<size_t>::const_iterator it,
+                                                                  std::vector<size_t>::const_iterator end) {
+                Linkset linksetLocal{config_, idMapping_, sequenceLengths_, false};
+                for (; it != end; ++it) {
+                    processPartition(linksetLocal, *it);
+                    pb.increase();
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                mergeCounts(linksetLocal);
+            };
+            executeParallel(partitions, config_->nThreads(), callback);
+            pb.unprotectedProgressBar().finish();
+        } else {
+            // parallel does slow things down, so use single thread by default
+            ProgressBar pb(partitions.size(), silent || config_->verbose() < 2);
+            for (auto p : partitions) {
+                processPartition(*this, p);
+                ++pb;
+            }
+            pb.finish();
+        }
+    }
+    //! Merge the Link s that \c rhs created from other seeds into this Linkset
+    /*! Unlike \c merge(), Link counts are added and, like \c addLink(), the Link with the bigger span is kept,
+     * so the result is the same as if all seeds were processed into this Linkset */
+    void mergeCounts(Linkset const & rhs) {
+        numDiscarded_ += rhs.numDiscarded_;
+        for (auto&& elem : rhs.linkset_) {
+            auto linkIt = linkset_.find(elem.first);
+            if (linkIt != linkset_.end() && linkIt->first.span() < elem.first.span()) {
+                auto count = linkIt->second;
+                linkset_.erase(linkIt);
+                linkset_.insert({elem.first, count});
+            }
+            linkset_[elem.first] += elem.second;
+        }
+    }
+    //! Orient the tiles of a new Link if canonical seeds are used, see \c orientOccurrences()
+    void orientTiles(std::vector<KmerOccurrence> & tiles, size_t span) const {
+        if (config_->canonicalSeeds()) { orientOccurrences(tiles, span, *sequenceLengths_); }
+    }
+
+
     //! Configuration object
     std::shared_ptr<Configuration const> config_;
     //! Assigns IDs to genome and sequence strings in order of their appeareances
@@ -360,6 +474,8 @@ private:
     bool parallel_;
     //! Used to obtain seed for random link selection if there are too many possibilities
     std::random_device rd_;
+    //! Sequence lengths by sequence ID
+    std::shared_ptr<tsl::hopscotch_map<size_t, size_t> const> sequenceLengths_;
 };
 
 #endif // LINKSET_H
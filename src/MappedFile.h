@@ -0,0 +1,63 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! Read-only memory mapping of a whole file
+/*! The mapping is released when the object is destroyed. Empty files are not mapped,
+ * in that case \c data() returns \c nullptr and \c size() returns zero. */
+class MappedFile {
+public:
+    //! c'tor
+    /*! \param filename Path to the file that is mapped into memory
+     * \param advice Expected access pattern, passed to \c madvise()
+     *
+     * \details Opens and maps the file, throws if this fails */
+    MappedFile(std::string const & filename, int advice = MADV_SEQUENTIAL)
+        : data_{nullptr}, size_{0} {
+        auto fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("[ERROR] -- MappedFile -- Failed to open " + filename);
+        }
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) != 0) {
+            ::close(fd);
+            throw std::runtime_error("[ERROR] -- MappedFile -- Failed to stat " + filename);
+        }
+        size_ = static_cast<size_t>(fileStat.st_size);
+        if (size_ > 0) {
+            auto addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("[ERROR] -- MappedFile -- Failed to map " + filename);
+            }
+            data_ = static_cast<char const *>(addr);
+            ::madvise(addr, size_, advice);
+        }
+        ::close(fd);    // mapping stays valid after closing the descriptor
+    }
+    MappedFile(MappedFile const &) = delete;
+    MappedFile & operator=(MappedFile const &) = delete;
+    //! d'tor
+    ~MappedFile() {
+        if (data_) { ::munmap(const_cast<char *>(data_), size_); }
+    }
+    //! Pointer to the first byte of the mapped file
+    char const * data() const { return data_; }
+    //! Size of the mapped file in bytes
+    size_t size() const { return size_; }
+
+private:
+    //! Start of the mapping
+    char const * data_;
+    //! Length of the mapping
+    size_t size_;
+};
+
+#endif // MAPPEDFILE_H
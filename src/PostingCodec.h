@@ -0,0 +1,84 @@
+#ifndef POSTINGCODEC_H
+#define POSTINGCODEC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KmerOccurrence.h"
+
+//! Delta and varint coding of the occurrence list (posting) of a seed ('--compress-postings')
+/*! The occurrences are sorted by sequence and position and stored in groups of the same sequence:
+ * the sequence ID (difference to the sequence of the previous group), the genome ID and the number of
+ * occurrences, then for each occurrence the difference to the previous position, shifted left by two bits
+ * that hold the reverse strand and the bigger k-mer flag. All numbers are LEB128 varints, i.e. seven bits
+ * per byte, so occurrences of repeats within a few kbp of each other need two or three bytes instead of eight.
+ *
+ * The order of the occurrences is not preserved, everything else is restored bit by bit */
+class PostingCodec {
+public:
+    //! Append the posting of \c occurrences to \c bytes
+    /*! \param scratch Buffer for the sorted occurrences, e.g. reused for all postings of a thread */
+    static void encode(OccurrenceRange occurrences, std::vector<KmerOccurrence> & scratch, std::vector<uint8_t> & bytes) {
+        scratch.assign(occurrences.begin(), occurrences.end());
+        std::sort(scratch.begin(), scratch.end(), [](KmerOccurrence const & lhs, KmerOccurrence const & rhs) {
+            if (lhs.sequence() != rhs.sequence()) { return lhs.sequence() < rhs.sequence(); }
+            if (lhs.genome() != rhs.genome()) { return lhs.genome() < rhs.genome(); }
+            return lhs.data().to_ullong() < rhs.data().to_ullong();   // position, then flags
+        });
+        uint64_t previousSequence = 0;
+        for (size_t i = 0; i < scratch.size();) {
+            auto sequence = scratch[i].sequence();
+            auto genome = scratch[i].genome();
+            auto groupEnd = i;
+            while (groupEnd < scratch.size() && scratch[groupEnd].sequence() == sequence && scratch[groupEnd].genome() == genome) { ++groupEnd; }
+            putVarint(sequence - previousSequence, bytes);
+            putVarint(genome, bytes);
+            putVarint(groupEnd - i, bytes);
+            uint64_t previousPosition = 0;
+            for (; i < groupEnd; ++i) {
+                auto position = scratch[i].position();
+                putVarint(((position - previousPosition) << 2)
+                          | (uint64_t{scratch[i].reverse()} << 1) | uint64_t{scratch[i].biggerKmerStored()}, bytes);
+                previousPosition = position;
+            }
+            previousSequence = sequence;
+        }
+    }
+    //! Replace the content of \c occurrences by the posting in [\c begin, \c end)
+    static void decode(uint8_t const * begin, uint8_t const * end, std::vector<KmerOccurrence> & occurrences) {
+        occurrences.clear();
+        uint64_t sequence = 0;
+        while (begin < end) {
+            sequence += getVarint(begin);
+            auto genome = getVarint(begin);
+            auto n = getVarint(begin);
+            uint64_t position = 0;
+            for (size_t i = 0; i < n; ++i) {
+                auto value = getVarint(begin);
+                position += value >> 2;
+                occurrences.emplace_back(static_cast<uint8_t>(genome), static_cast<uint32_t>(sequence), position,
+                                         (value & 2) != 0, BiggerKmerStored{(value & 1) != 0});
+            }
+        }
+    }
+
+private:
+    //! Read a varint and advance \c p behind it
+    static uint64_t getVarint(uint8_t const * & p) {
+        uint64_t value = *p & 0x7f;
+        for (unsigned shift = 7; *p++ & 0x80; shift += 7) { value |= uint64_t{*p & 0x7fu} << shift; }
+        return value;
+    }
+    //! Append \c value as varint
+    static void putVarint(uint64_t value, std::vector<uint8_t> & bytes) {
+        while (value >= 0x80) {
+            bytes.emplace_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.emplace_back(static_cast<uint8_t>(value));
+    }
+};
+
+#endif // POSTINGCODEC_H
@@ -0,0 +1,14 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <cstddef>
+
+//! Number of seeds per block of the batched lookups and inserts of SeedIndex and SeedMap
+/*! Each stage of a batched operation issues the memory accesses of all seeds of a block before the next
+ * stage uses them, so the cache misses of a block are served in parallel instead of one after another */
+constexpr size_t prefetchBlockSize = 32;
+
+//! Hint the CPU to load the cache line of \c address, which is accessed in a later stage of a batch
+inline void prefetch(void const * address) { __builtin_prefetch(address, 0, 3); }
+
+#endif // PREFETCH_H
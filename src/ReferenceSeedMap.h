@@ -2,35 +2,45 @@
 #define REFERENCESEEDMAP_H
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <tsl/hopscotch_map.h>
 
 #include "Configuration.h"
 #include "ParallelizationUtils.h"
-#include "TwoBitKmer.h"
 
-template<typename TwoBitSeedDataType>
+//! Seeds occurring in each reference (genome0) sequence, as slots of the seed map
+/*! A slot is the stable index of a seed in the seed map (see \c SeedMap::occurrencesOfSlot()), so the
+ * seeds are not copied and their occurrences are accessed without a lookup */
 class ReferenceSeedMap {
 public:
-    // store seeds occurring in each reference (genome0) sequence
-    using ReferenceSeedMapType = tsl::hopscotch_map<size_t, std::vector<TwoBitKmer<TwoBitSeedDataType>>>;
+    // store slots of the seeds occurring in each reference (genome0) sequence
+    using ReferenceSeedMapType = tsl::hopscotch_map<size_t, std::vector<uint64_t>>;
 
     //! c'tor
     ReferenceSeedMap(Configuration const & config) : nThreads_{config.nThreads()}, referenceSeedMap_{} {}
 
-    //! Add a single seed to sid, no check if sid is actually valid!
-    void addSeed(size_t sid, TwoBitKmer<TwoBitSeedDataType> const & seed) {
-        referenceSeedMap_[sid].emplace_back(seed);
+    //! Add a single slot to sid, no check if sid is actually valid!
+    /*! Skips \c slot if it was the last slot added to sid, i.e. if slots are added in ascending order, the
+     * lists stay sorted and unique */
+    void addSlot(size_t sid, uint64_t slot) {
+        auto& slots = referenceSeedMap_[sid];
+        if (slots.empty() || slots.back() != slot) { slots.emplace_back(slot); }
     }
-    //! Remove duplicates in referenceSeedMap_ in parallel
+    //! Sort the slots of each reference sequence and remove duplicates in parallel
     void cleanupReferenceSeeds(bool parallel = true) {
         auto callback = [](ReferenceSeedMapType & referenceSeedMap,
                            typename ReferenceSeedMapType::const_iterator it,
                            typename ReferenceSeedMapType::const_iterator end) {
+            std::vector<uint64_t> buffer;
             for (; it != end; ++it) {
-                auto& seedVector = referenceSeedMap.at(it->first);
-                std::sort(seedVector.begin(), seedVector.end());
-                auto last = std::unique(seedVector.begin(), seedVector.end());
-                seedVector.erase(last, seedVector.end());   // remove indeterminate elements resulting from std::unique
-                seedVector.shrink_to_fit();
+                auto& slots = referenceSeedMap.at(it->first);
+                radixSort(slots, buffer);
+                auto last = std::unique(slots.begin(), slots.end());
+                slots.erase(last, slots.end());   // remove indeterminate elements resulting from std::unique
+                slots.shrink_to_fit();
             }
         };
         size_t nThreads = (parallel) ? nThreads_ : 1;
@@ -38,17 +48,35 @@ public:
     }
     //! Forward clear method of referenceSeedMap_
     void clear() { referenceSeedMap_.clear(); }
-    //! Add all seeds from \c rhs to this map
+    //! Add all slots from \c rhs to this map
     void merge(ReferenceSeedMap const & rhs) {
         for (auto&& elem : rhs.referenceSeedMap_) {
-            auto& seedVector = referenceSeedMap_[elem.first];
-            seedVector.insert(seedVector.end(), elem.second.begin(), elem.second.end());
+            auto& slots = referenceSeedMap_[elem.first];
+            slots.insert(slots.end(), elem.second.begin(), elem.second.end());
         }
     }
     //! Getter for \c referenceSeedMap_
     auto const & referenceSeedMap() const { return referenceSeedMap_; }
 
 private:
+    //! LSD radix sort of \c values by bytes, skipping the leading bytes that are zero in all values
+    /*! \param buffer Scratch space, e.g. reused for all lists of a thread */
+    static void radixSort(std::vector<uint64_t> & values, std::vector<uint64_t> & buffer) {
+        if (values.size() < 64) {   // counting overhead dominates for short lists
+            std::sort(values.begin(), values.end());
+            return;
+        }
+        uint64_t maxValue = *std::max_element(values.begin(), values.end());
+        buffer.resize(values.size());
+        for (unsigned shift = 0; shift < 64 && (maxValue >> shift) > 0; shift += 8) {
+            std::array<size_t, 257> starts{};
+            for (auto value : values) { ++starts[((value >> shift) & 0xff) + 1]; }
+            for (size_t b = 1; b < starts.size(); ++b) { starts[b] += starts[b - 1]; }
+            for (auto value : values) { buffer[starts[(value >> shift) & 0xff]++] = value; }
+            values.swap(buffer);
+        }
+    }
+
     size_t nThreads_;
     ReferenceSeedMapType referenceSeedMap_;
 };
@@ -0,0 +1,88 @@
+#ifndef ROLLINGKMERWINDOW_H
+#define ROLLINGKMERWINDOW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CustomHashGeneral.h"
+
+//! Window of the last \c span bases of a sequence, packed with two bits per base
+/*! Uses the encoding of TwoBitKmer and TwoBitSequence (A = 0, C = 1, T = 2, G = 3), base \c i
+ * of the window is stored in bits 2*(i%32) of word i/32. The reverse complement of the window
+ * is maintained alongside. Pushing a base costs O(span/32), i.e. O(1) for a fixed span.
+ *
+ * The window only holds ACGT, callers \c reset() it at any other character. */
+class RollingKmerWindow {
+public:
+    //! c'tor
+    /*! \param span Number of bases in the window */
+    RollingKmerWindow(size_t span)
+        : fill_{0}, forward_((span + 31) / 32, 0), reverseComplement_((span + 31) / 32, 0), span_{span},
+          topMask_{(span % 32) ? ((uint64_t{1} << (2 * (span % 32))) - 1) : ~uint64_t{0}},
+          topShift_{2 * ((span - 1) % 32)} {}
+    //! Return true if the lexicographically bigger of window and reverse complement is the window itself
+    /*! Corresponds to the respective bit in KmerOccurrence, palindromes return false */
+    bool forwardIsBigger() const {
+        for (size_t i = 0; i < forward_.size(); ++i) {
+            auto diff = forward_[i] ^ reverseComplement_[i];
+            if (diff) {
+                auto shift = __builtin_ctzll(diff) & ~1;    // first differing base
+                return rank((forward_[i] >> shift) & 3) > rank((reverseComplement_[i] >> shift) & 3);
+            }
+        }
+        return false;
+    }
+    //! Getter for member \c forward_
+    auto const & forward() const { return forward_; }
+    //! Return true if the window holds \c span bases
+    bool full() const { return fill_ >= span_; }
+    //! Return true if the window equals its reverse complement
+    bool palindromic() const { return forward_ == reverseComplement_; }
+    //! Packed reverse complement of the window, its first base in the lowest bits of word 0
+    auto const & reverseComplement() const { return reverseComplement_; }
+    //! Hash value of the bases in the window
+    size_t hash() const {
+        size_t seed = 0;
+        for (auto word : forward_) { customCombineHash(seed, mixHash64(word)); }
+        return seed;
+    }
+    //! Append the base with two bit code \c code, the first base leaves the window if it is full
+    void push(uint64_t code) {
+        auto n = forward_.size();
+        for (size_t i = 0; i + 1 < n; ++i) { forward_[i] = (forward_[i] >> 2) | (forward_[i + 1] << 62); }
+        forward_[n - 1] = (forward_[n - 1] >> 2) | (code << topShift_);
+        for (size_t i = n - 1; i > 0; --i) { reverseComplement_[i] = (reverseComplement_[i] << 2) | (reverseComplement_[i - 1] >> 62); }
+        reverseComplement_[0] = (reverseComplement_[0] << 2) | (code ^ 2);    // complement: A <-> T, C <-> G
+        reverseComplement_[n - 1] &= topMask_;
+        ++fill_;
+    }
+    //! Empty the window
+    void reset() {
+        fill_ = 0;
+        std::fill(forward_.begin(), forward_.end(), 0);
+        std::fill(reverseComplement_.begin(), reverseComplement_.end(), 0);
+    }
+    //! Getter for member \c span_
+    auto span() const { return span_; }
+
+private:
+    //! Map a two bit code to the rank of its base in lexicographic order (A < C < G < T)
+    static uint64_t rank(uint64_t code) { return code ^ (code >> 1); }
+
+    //! Number of bases pushed since the last reset
+    size_t fill_;
+    //! Packed window
+    std::vector<uint64_t> forward_;
+    //! Packed reverse complement of the window
+    std::vector<uint64_t> reverseComplement_;
+    //! Number of bases in the window
+    size_t span_;
+    //! Valid bits in the last word
+    uint64_t topMask_;
+    //! Shift of the last base within the last word
+    uint64_t topShift_;
+};
+
+#endif // ROLLINGKMERWINDOW_H
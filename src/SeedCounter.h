@@ -0,0 +1,172 @@
+#ifndef SEEDCOUNTER_H
+#define SEEDCOUNTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include "tsl/hopscotch_map.h"
+#include "tsl/hopscotch_set.h"
+#include "KmerOccurrence.h"
+#include "ParallelizationUtils.h"
+#include "Prefetch.h"
+#include "SeedIndex.h"
+#include "TwoBitKmer.h"
+
+
+
+//! Exact seed occurrence counts for a counting pass before the SeedMap is filled ('--count-seeds')
+/*! Counts the occurrences of each seed per mask and genome. Afterwards, \c finalize() determines the
+ * seeds that fail the per genome occurrence limits, so they are never inserted into the SeedMap, and
+ * the number of remaining distinct seeds, so the SeedMap can be reserved exactly. The counts are split
+ * into shards by the top bits of the seed hash like the shards of a SeedMap.
+ *
+ * The counts of all seeds of a shard are stored in a single pool, each seed maps to the position of its
+ * first count, so there is no allocation and no vector header per distinct seed. */
+template <typename TwoBitSeedDataType>
+class SeedCounter {
+public:
+    using CountMapType = tsl::hopscotch_map<TwoBitKmer<TwoBitSeedDataType>,
+                                            size_t,     // count of mask m in genome g at pool[value + m * nGenomes + g]
+                                            TwoBitKmerHash<TwoBitSeedDataType>>;
+    using SeedSetType = tsl::hopscotch_set<TwoBitKmer<TwoBitSeedDataType>, TwoBitKmerHash<TwoBitSeedDataType>>;
+
+    //! c'tor
+    /*! \param nMasks Number of masks
+     * \param nGenomes Number of genomes
+     * \param shardBits Number of hash bits that select a shard, use the value of the SeedMap to reserve */
+    SeedCounter(size_t nMasks, size_t nGenomes, size_t shardBits)
+        : counts_(size_t{1} << shardBits), dropped_(size_t{1} << shardBits, std::vector<SeedSetType>(nMasks)),
+          kept_(size_t{1} << shardBits, 0), nGenomes_{nGenomes}, nMasks_{nMasks}, pools_(size_t{1} << shardBits),
+          shardBits_{shardBits}, shardMutexes_(size_t{1} << shardBits) {}
+
+    //! Buffers the seeds of a single thread for each shard and counts them in batches, like SeedMap::ShardInserter
+    class ShardCounter {
+    public:
+        //! c'tor
+        /*! \param counter SeedCounter to count into */
+        ShardCounter(SeedCounter & counter)
+            : bufferSize_{std::clamp(bufferBudget_ / std::max<size_t>(counter.counts_.size(), 1), prefetchBlockSize, maxBufferSize_)},
+              buffers_(counter.counts_.size()), counter_{counter} {}
+        //! Buffer a seed, count the buffer of its shard if it is full
+        void operator()(TwoBitKmer<TwoBitSeedDataType> const & seed, KmerOccurrence const & occurrence, size_t maskIndex) {
+            auto shard = counter_.shardOf(seed);
+            buffers_[shard].emplace_back(seed, occurrence, maskIndex);
+            if (buffers_[shard].size() >= bufferSize_) { flushShard(shard); }
+        }
+        //! Count all buffered seeds
+        void flush() {
+            for (size_t shard = 0; shard < buffers_.size(); ++shard) { flushShard(shard); }
+        }
+
+    private:
+        //! Count the buffered seeds of \c shard
+        void flushShard(size_t shard) {
+            if (buffers_[shard].empty()) { return; }
+            auto& map = counter_.counts_[shard];
+            auto& pool = counter_.pools_[shard];
+            auto nCounts = counter_.nMasks_ * counter_.nGenomes_;
+            std::unique_lock<std::mutex> lock(counter_.shardMutexes_[shard]);
+            for (auto&& record : buffers_[shard]) {
+                auto inserted = map.emplace(record.seed, pool.size());
+                if (inserted.second) { pool.resize(pool.size() + nCounts, 0); }
+                auto& count = pool[inserted.first->second + record.maskIndex * counter_.nGenomes_ + record.occurrence.genome()];
+                if (count < std::numeric_limits<uint32_t>::max()) { ++count; }
+            }
+            lock.unlock();
+            buffers_[shard].clear();
+        }
+
+        //! Number of buffered seeds of all shards together, see SeedMap::ShardInserter
+        static constexpr size_t bufferBudget_ = size_t{1} << 16;
+        //! Maximum number of buffered seeds per shard
+        static constexpr size_t maxBufferSize_ = 1024;
+        //! Number of buffered seeds per shard before they are counted
+        size_t bufferSize_;
+        //! Seeds waiting to be counted, one buffer per shard
+        std::vector<std::vector<SeedRecord<TwoBitSeedDataType>>> buffers_;
+        //! Target SeedCounter
+        SeedCounter & counter_;
+    };
+
+    //! Check if the seed of mask \c maskIndex was dropped by \c finalize()
+    bool dropped(TwoBitKmer<TwoBitSeedDataType> const & seed, size_t maskIndex) const {
+        auto& set = dropped_[shardOf(seed)][maskIndex];
+        return set.size() && set.find(seed) != set.end();
+    }
+    //! Determine the seeds that fail the occurrence limits, then release the counts
+    /*! A seed of a mask is dropped if it occurs more than \c maxPerGenome times or less than \c minPerGenome
+     * (but at least once) in any genome, Linkset::processOccurrences() would discard it anyway.
+     * \param maxPerGenome Maximum number of occurrences in a genome
+     * \param minPerGenome Minimum number of occurrences in a genome
+     * \param referenceMax If \c false, do not apply \c maxPerGenome to the reference genome, e.g. because
+     *                     reference occurrences are later split by sequence (1-vs-all mode)
+     * \param nThreads Number of threads to use */
+    void finalize(size_t maxPerGenome, size_t minPerGenome, bool referenceMax, size_t nThreads) {
+        std::vector<size_t> shardIDs(counts_.size());
+        std::iota(shardIDs.begin(), shardIDs.end(), 0);
+        auto evaluate = [this, maxPerGenome, minPerGenome, referenceMax](std::vector<size_t>::const_iterator it,
+                                                                        std::vector<size_t>::const_iterator end) {
+            for (; it != end; ++it) {
+                auto& pool = pools_[*it];
+                for (auto&& elem : counts_[*it]) {
+                    size_t nDropped = 0;
+                    for (size_t maskID = 0; maskID < nMasks_; ++maskID) {
+                        for (size_t genomeID = 0; genomeID < nGenomes_; ++genomeID) {
+                            size_t count = pool[elem.second + maskID * nGenomes_ + genomeID];
+                            if ((count > maxPerGenome && (referenceMax || genomeID > 0))
+                                    || (count > 0 && count < minPerGenome)) {
+                                dropped_[*it][maskID].insert(elem.first);
+                                ++nDropped;
+                                break;
+                            }
+                        }
+                    }
+                    if (nDropped < nMasks_) { ++kept_[*it]; }
+                }
+                CountMapType().swap(counts_[*it]);
+                std::vector<uint32_t>().swap(pool);
+            }
+        };
+        executeParallel(shardIDs, std::max<size_t>(nThreads, 1), evaluate);
+    }
+    //! Number of distinct seeds in \c shard that are not dropped for all masks, valid after \c finalize()
+    size_t numKept(size_t shard) const { return kept_.at(shard); }
+    //! Number of dropped pairs of seed and mask, valid after \c finalize()
+    size_t numDropped() const {
+        size_t n = 0;
+        for (auto&& shard : dropped_) {
+            for (auto&& set : shard) { n += set.size(); }
+        }
+        return n;
+    }
+
+private:
+    //! Shard of \c seed, i.e. the top \c shardBits_ bits of its hash (same as SeedMap::shardOf())
+    size_t shardOf(TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        return (shardBits_ == 0) ? 0 : (static_cast<uint64_t>(TwoBitKmerHash<TwoBitSeedDataType>{}(seed)) >> (64 - shardBits_));
+    }
+
+    //! Position of the counts of each seed in \c pools_, split by seed hash
+    std::vector<CountMapType> counts_;
+    //! Dropped seeds for each shard and mask
+    std::vector<std::vector<SeedSetType>> dropped_;
+    //! Number of distinct seeds in each shard that are kept for at least one mask
+    std::vector<size_t> kept_;
+    //! Number of genomes
+    size_t nGenomes_;
+    //! Number of masks
+    size_t nMasks_;
+    //! Occurrence counts of the seeds of each shard, \c nMasks_ * \c nGenomes_ consecutive counts per seed
+    std::vector<std::vector<uint32_t>> pools_;
+    //! Number of hash bits that select a shard
+    size_t shardBits_;
+    //! One lock for each shard
+    std::vector<std::mutex> shardMutexes_;
+};
+
+#endif // SEEDCOUNTER_H
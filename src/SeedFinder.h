@@ -7,17 +7,22 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <sstream>
 
 #include "Configuration.h"
 #include "Cubeset.h"
 #include "DiagonalMatchesFilter.h"
 #include "ExtractSeeds.h"
 #include "FastaCollection.h"
+#include "FastaCollectionView.h"
+#include "GenomeCache.h"
 #include "IdentifierMapping.h"
 #include "Linkset.h"
 #include "Output.h"
 #include "ParallelizationUtils.h"
 #include "ParallelProgressBarHandler.h"
+#include "SeedIndex.h"
+#include "SeedIndexFile.h"
 #include "SeedMap.h"
 #include "SpacedSeedMaskCollection.h"
 #include "TwoBitKmer.h"
@@ -50,12 +55,11 @@ constexpr auto isSeedKmerMap(SeedMapType const & m) { return isSeedKmerMapImpl(m
 // Now, factory function templates depending on above checks
 template<typename SeedMapType>
 auto createSeedMapImpl(std::shared_ptr<SeedMapType> seedMap,
-                       std::shared_ptr<FastaCollection const> fastaCollection,
+                       std::shared_ptr<FastaCollectionView const> fastaCollection,
                        ParallelVerboseInfo const & pinf,
                        std::false_type) { // for SeedMap
     Timestep tsDirectExtract("Extracting seeds from input files", pinf.zeroOutput);
-    seedMap->extractSeeds(fastaCollection, pinf.allowParallelExecution);
-    seedMap->cleanupReferenceSeeds(pinf.allowParallelExecution);
+    seedMap->extractSeeds(fastaCollection, pinf.allowParallelExecution);   // also collects the reference slots
     tsDirectExtract.endAndPrint();
     if (!pinf.zeroOutput) { seedMap->printStatistics(); }
     return seedMap;
@@ -63,7 +67,7 @@ auto createSeedMapImpl(std::shared_ptr<SeedMapType> seedMap,
 
 template<typename SeedMapType>
 auto createSeedMapImpl(std::shared_ptr<SeedMapType> seedKmerMap,
-                       std::shared_ptr<FastaCollection const> fastaCollection,
+                       std::shared_ptr<FastaCollectionView const> fastaCollection,
                        ParallelVerboseInfo const & pinf,
                        std::true_type) { // for SeedKmerMap
     (void)seedKmerMap; (void)fastaCollection; (void)pinf;
@@ -72,26 +76,13 @@ auto createSeedMapImpl(std::shared_ptr<SeedMapType> seedKmerMap,
 
 
 
-//! Create partial FastaCollection from a complete FastaCollection and a vector of sequence IDs
-/*! The sequence IDs must denote a subset of sequences present in \c completeFastaCollection */
-inline std::shared_ptr<FastaCollection const> getPartialFastaCollection(std::vector<size_t> const & sequenceIDs,
-                                                                        FastaCollection const & completeFastaCollection,
-                                                                        IdentifierMapping const & idMap) {
-    auto fastaCollection = std::make_shared<FastaCollection>();
-    tsl::hopscotch_map<std::string, FastaRepresentation> genomeToFasta;
-    for (auto sid : sequenceIDs) {
-        auto& seqTuple = idMap.querySequenceTuple(sid);
-        auto& genome = idMap.queryGenomeName(seqTuple.gid);
-        if (genomeToFasta.find(genome) == genomeToFasta.end()) {
-            genomeToFasta.insert({genome, FastaRepresentation{FastaGenomeName{genome}}});
-        }
-        auto& faSeq = completeFastaCollection.fastaSequence(sid, idMap);
-        genomeToFasta.at(genome).addSequence(faSeq.sequenceName(), faSeq.sequence());
-    }
-    for (auto&& elem : genomeToFasta) {
-        fastaCollection->emplace(elem.first, elem.second);
-    }
-    return fastaCollection;
+//! Create a view on a subset of a complete FastaCollection from a vector of sequence IDs
+/*! The sequence IDs must denote a subset of sequences present in \c completeFastaCollection,
+ * the sequences are referenced, not copied */
+inline std::shared_ptr<FastaCollectionView const> getPartialFastaCollection(std::vector<size_t> const & sequenceIDs,
+                                                                            std::shared_ptr<FastaCollection const> completeFastaCollection,
+                                                                            IdentifierMapping const & idMap) {
+    return std::make_shared<FastaCollectionView const>(sequenceIDs, completeFastaCollection, idMap);
 }
 
 
@@ -114,26 +105,52 @@ public:
     static struct OneVsAll{} oneVsAll;
     static struct PreFilter{} preFilter;
 
-    BasicPipeline(std::shared_ptr<FastaCollection const> fastaCollection,
+    using PersistedIndexType = SeedIndex<typename SeedMapType::TwoBitSeedDataType_>;
+    using SeedSpillType = SeedSpill<typename SeedMapType::TwoBitSeedDataType_>;
+
+    BasicPipeline(std::shared_ptr<FastaCollectionView const> fastaCollection,
                   std::shared_ptr<Output> output,
                   std::shared_ptr<IdentifierMapping const> idMap,
                   std::shared_ptr<tsl::hopscotch_map<size_t, size_t> const> seqLens,
-                  std::shared_ptr<Configuration const> config)
+                  std::shared_ptr<Configuration const> config,
+                  std::shared_ptr<PersistedIndexType const> persistedIndex = nullptr)
         : config_{config}, fastaCollection_{fastaCollection},
           idMap_{idMap}, mutexOutput_{}, output_{output},
-          seqLens_{seqLens} {}
+          persistedIndex_{persistedIndex}, seqLens_{seqLens} {}
 
     void run(AllVsAll, ParallelVerboseInfo const & pinf) {
         Timestep tsSeedMap("~~~ Create Seed Map (all-vs-all) ~~~", pinf.zeroOutput);
-        auto seedMap = createSeedMap(fastaCollection_, pinf); // if run() allowed to start parallel execution, run seed extraction in parallel
+        std::shared_ptr<SeedMapType> seedMap;
+        std::unique_ptr<SeedSpillType> spill;
+        if (config_->seedPartitions() > 1) {
+            // '--seed-partitions', seeds are written to disk and loaded one partition at a time during link creation
+            Timestep tsSpill("Extracting seeds from input files to disk", pinf.zeroOutput);
+            seedMap = std::make_shared<SeedMapType>(config_, idMap_);
+            spill = std::make_unique<SeedSpillType>(config_->seedPartitions(), seedMap->weight(), config_->spillDirectory());
+            seedMap->extractSeeds(fastaCollection_, *spill, pinf.allowParallelExecution);
+            tsSpill.endAndPrint();
+            if (!pinf.zeroOutput) {
+                std::cout << "[INFO] -- Spilled " << spill->numRecords() << " seed occurrences to "
+                          << spill->numPartitions() << " partitions in " << config_->spillDirectory() << std::endl;
+            }
+        } else {
+            seedMap = createSeedMap(fastaCollection_, pinf); // if run() allowed to start parallel execution, run seed extraction in parallel
+        }
         tsSeedMap.endAndPrint();
         Timestep ts("~~~ Create Linkset and Output Matches (all-vs-all) ~~~", pinf.zeroOutput); // if silent, timestep in silent mode
         MM::MemoryMonitor mm;
         if (!pinf.zeroOutput) { std::cout << "Memory usage before link creation" << std::endl << mm << std::endl; }
         Timestep tsLinkset{"Creating Links", pinf.zeroOutput};
 
-        auto linkset = std::make_shared<LinksetType>(config_, seedMap->idMap(), pinf.allowParallelExecution);
-        linkset->createLinks(*seedMap, pinf.zeroOutput);
+        auto linkset = std::make_shared<LinksetType>(config_, seedMap->idMap(), seqLens_, pinf.allowParallelExecution);
+        if (spill) {
+            for (size_t p = 0; p < spill->numPartitions(); ++p) {
+                seedMap->loadPartition(*spill, p, pinf.allowParallelExecution);
+                createLinks(*linkset, *seedMap, pinf.zeroOutput);
+            }
+        } else {
+            createLinks(*linkset, *seedMap, pinf.zeroOutput);
+        }
 
         if (!pinf.zeroOutput) { std::cout << "Memory usage after link creation" << std::endl << mm << std::endl; }
 
@@ -175,7 +192,7 @@ public:
                     &seedMap](ParallelVerboseInfo lambdaPinf,
                               typename std::vector<size_t>::const_iterator it,
                               typename std::vector<size_t>::const_iterator end) {
-            auto linkset = std::make_shared<LinksetType>(config_, seedMap->idMap(), lambdaPinf.allowParallelExecution);
+            auto linkset = std::make_shared<LinksetType>(config_, seedMap->idMap(), seqLens_, lambdaPinf.allowParallelExecution);
             for (; it != end; ++it) {
                 linkset->createLinks(*seedMap, *it);
                 if (config_->performDiagonalFiltering()) {
@@ -230,7 +247,7 @@ public:
             for (; it != end; ++it) {
                 auto& cluster = **it;
                 std::vector<size_t> sidv{cluster.sids.begin(), cluster.sids.end()};
-                auto partialFastaCollection = getPartialFastaCollection(sidv, *fastaCollection_, *idMap_);
+                auto partialFastaCollection = getPartialFastaCollection(sidv, fastaCollection_->fastaCollection(), *idMap_);
                 //  -> idMapping needs to be consistent, only recreate seqLens for Cube scoring
                 auto partialSequenceLengths = std::make_shared<tsl::hopscotch_map<size_t, size_t>>();
                 partialFastaCollection->fillSequenceLengths(*partialSequenceLengths, *idMap_);
@@ -240,7 +257,7 @@ public:
                 tsPostSeedMap.endAndPrint();
                 // create linkset with only relevant links
                 Timestep tsLinkset("Create Relevant Links", lambdaPinf.zeroOutput);
-                auto linkset = std::make_shared<LinksetType>(config_, idMap_, lambdaPinf.allowParallelExecution);
+                auto linkset = std::make_shared<LinksetType>(config_, idMap_, partialSequenceLengths, lambdaPinf.allowParallelExecution);
                 //linkset->createLinks(*seedMap, preCubeset.relevantCubeSet());
                 linkset->createLinks(*seedMap, cluster.cubes, lambdaPinf.zeroOutput);
                 seedMap->clear(); // save memory
@@ -271,7 +288,15 @@ public:
     }
 
 private:
-    std::shared_ptr<SeedMapType> createSeedMap(std::shared_ptr<FastaCollection const> fastaCollection,
+    //! Create the links of all seeds in \c seedMap, joined with \c persistedIndex_ if set
+    void createLinks(LinksetType & linkset, SeedMapType const & seedMap, bool silent) const {
+        if (persistedIndex_) {
+            linkset.createLinks(seedMap, *persistedIndex_, silent);   // '--seed-index', seedMap only holds the query genomes
+        } else {
+            linkset.createLinks(seedMap, silent);
+        }
+    }
+    std::shared_ptr<SeedMapType> createSeedMap(std::shared_ptr<FastaCollectionView const> fastaCollection,
                                                ParallelVerboseInfo const & pinf,
                                                bool preFilter = false) const {
         auto seedMap = (preFilter)
@@ -322,10 +347,11 @@ private:
     }
 
     std::shared_ptr<Configuration const> const config_;
-    std::shared_ptr<FastaCollection const> const fastaCollection_;
+    std::shared_ptr<FastaCollectionView const> const fastaCollection_;
     std::shared_ptr<IdentifierMapping const> const idMap_;
     std::mutex mutexOutput_;
     std::shared_ptr<Output> const output_;
+    std::shared_ptr<PersistedIndexType const> const persistedIndex_;
     std::shared_ptr<tsl::hopscotch_map<size_t, size_t> const> const seqLens_;
 
 };
@@ -344,7 +370,7 @@ public:
     SeedFinder(std::shared_ptr<Configuration> config)
         : allvsall_{config->allvsall()},
           config_{config}, mutexOutput_{}, output_{std::make_shared<Output>(config_)},
-          parallelSeedMap_{true},
+          parallelSeedMap_{true}, persistedIndex_{},
           pipelineA_{!(config_->performDiagonalFiltering() || config_->performGeometricHashing())} {
         std::cout << "[INFO] -- Masks used: " << *(config_->maskCollection()) << std::endl << std::endl;
     }
@@ -378,12 +404,30 @@ public:
         // global sequence information
         auto completeIDMap = blankIDMap();
         auto completeSequenceLengths = std::make_shared<tsl::hopscotch_map<size_t, size_t>>();
-        auto completeFastaCollection = (fastaInput) ? loadFastas() : std::make_shared<FastaCollection>();
-        if (fastaInput) {
-            fillIDMapSequenceLengths(*completeFastaCollection, *completeIDMap, *completeSequenceLengths);
-        } else {
+        std::shared_ptr<SeedIndexFile const> seedIndexFile;
+        if (!config_->seedIndex().empty()) {
+            // indexed genomes and sequences keep their IDs, the query genomes get the IDs behind them
+            std::cout << "[INFO] -- Matching against seed index " << config_->seedIndex() << std::endl;
+            seedIndexFile = std::make_shared<SeedIndexFile const>(config_->seedIndex());
+            seedIndexFile->checkCompatible(*config_);
+            seedIndexFile->fillIdentifierMapping(*completeIDMap, *completeSequenceLengths);
+        }
+        auto completeFastaCollection = (fastaInput)
+                ? loadFastas(*completeIDMap, *completeSequenceLengths)
+                : std::make_shared<FastaCollection>();
+        if (!fastaInput) {
             throw std::runtime_error("[ERROR] -- SeedFinder::run() -- Metagraph not available in this version");
         }
+        setOccurrenceLayout(*completeIDMap, *completeSequenceLengths, seedIndexFile.get());
+        if (seedIndexFile) { persistedIndex_ = seedIndexFile->seedIndex<TwoBitSeedDataType>(); }
+
+        // ONLY BUILD AND WRITE THE SEED INDEX
+        if (!config_->buildSeedIndex().empty()) {
+            buildSeedIndex(std::make_shared<FastaCollectionView const>(completeFastaCollection), completeIDMap, *completeSequenceLengths);
+            tsRun.endAndPrint();
+            output_->addRunInfo("runtime", tsRun.elapsed(Timestep::minutes));
+            return;
+        }
 
         // RUN ALL-VS-ALL OR 1-VS-ALL IN BATCH MODE
         if (batchvsbatch) {
@@ -396,7 +440,7 @@ public:
             size_t run = 1; size_t total = batches.size();
             for (auto&& sids : batches) {
                 Timestep tsBatchN("Running batch ("+std::to_string(run)+"/"+std::to_string(total)+")");
-                auto fastaCollection = getPartialFastaCollection(sids, *completeFastaCollection, *completeIDMap);
+                auto fastaCollection = getPartialFastaCollection(sids, completeFastaCollection, *completeIDMap);
                 auto idMap = blankIDMap();
                 auto sequenceLengths = std::make_shared<tsl::hopscotch_map<size_t, size_t>>();
                 fillIDMapSequenceLengths(*fastaCollection, *idMap, *sequenceLengths); // only make sequences and IDs of this batch visible (important for GH scoring)
@@ -409,7 +453,8 @@ public:
         // RUN ALL-VS-ALL OR 1-VS-ALL ON COMPLETE DATA
         else {
             if (fastaInput) {
-                callBasicPipeline<SeedMap<TwoBitSeedDataType>>(completeFastaCollection, completeIDMap, completeSequenceLengths);
+                callBasicPipeline<SeedMap<TwoBitSeedDataType>>(std::make_shared<FastaCollectionView const>(completeFastaCollection),
+                                                               completeIDMap, completeSequenceLengths);
             } else {
                 throw std::runtime_error("[ERROR] -- SeedFinder::run() -- SeedKmerMap not available in this version");
             }
@@ -422,6 +467,17 @@ public:
     auto fastaBatches(IdentifierMapping const & idMap) const { return getFastaBatches(idMap); } // for testing
 
 private:
+    //! Build a SeedIndex of the complete input and write it to '--build-seed-index'
+    void buildSeedIndex(std::shared_ptr<FastaCollectionView const> fastaCollection,
+                        std::shared_ptr<IdentifierMapping const> idMap,
+                        tsl::hopscotch_map<size_t, size_t> const & sequenceLengths) {
+        Timestep tsIndex("~~~ Build Seed Index ~~~");
+        auto pinf = ParallelVerboseInfo{true, (config_->verbose() == 0)};
+        auto seedMap = createSeedMapImpl(std::make_shared<SeedMap<TwoBitSeedDataType>>(config_, idMap), fastaCollection, pinf, std::false_type{});
+        std::cout << "[INFO] -- Writing seed index " << config_->buildSeedIndex() << std::endl;
+        SeedIndexFile::write(config_->buildSeedIndex(), *config_, *idMap, sequenceLengths, seedMap->seedIndex());
+        tsIndex.endAndPrint();
+    }
     //! Empty idMap, only genome IDs 0 and 1 are set
     std::shared_ptr<IdentifierMapping> blankIDMap() const {
         auto idMap = std::make_shared<IdentifierMapping>(config_->genome1());
@@ -429,12 +485,12 @@ private:
         return idMap;
     }
     template<typename SeedMapType>
-    void callBasicPipeline(std::shared_ptr<FastaCollection const> fastaCollection,
+    void callBasicPipeline(std::shared_ptr<FastaCollectionView const> fastaCollection,
                            std::shared_ptr<IdentifierMapping const> idMap,
                            std::shared_ptr<tsl::hopscotch_map<size_t, size_t> const> sequenceLengths) {
         if (config_->performGeometricHashing()) {
             auto pipeline = BasicPipeline<SeedMapType,
-                                          Linkset<LinkPtr, LinkPtrHashIgnoreSpan, LinkPtrEqualIgnoreSpan>>{fastaCollection, output_, idMap, sequenceLengths, config_};
+                                          Linkset<LinkPtr, LinkPtrHashIgnoreSpan, LinkPtrEqualIgnoreSpan>>{fastaCollection, output_, idMap, sequenceLengths, config_, persistedIndex_};
             if (config_->preMaskCollection()) {
                 if (allvsall_) {
                     pipeline.run(pipeline.allVsAll, pipeline.preFilter, ParallelVerboseInfo{true, (config_->verbose() == 0)}); // run all-vs-all, never called in parallel thus allow parallel and output if verbose >= 1
@@ -450,7 +506,7 @@ private:
             }
         } else { // no need for link ptrs, save some memory
             BasicPipeline<SeedMapType,
-                          Linkset<Link, LinkHashIgnoreSpan, LinkEqualIgnoreSpan>> pipeline{fastaCollection, output_, idMap, sequenceLengths, config_};
+                          Linkset<Link, LinkHashIgnoreSpan, LinkEqualIgnoreSpan>> pipeline{fastaCollection, output_, idMap, sequenceLengths, config_, persistedIndex_};
             if (config_->preMaskCollection()) {
                 if (allvsall_) {
                     pipeline.run(pipeline.allVsAll, pipeline.preFilter, ParallelVerboseInfo{true, (config_->verbose() == 0)}); // run all-vs-all, never called in parallel thus allow parallel and output if verbose >= 1
@@ -466,6 +522,31 @@ private:
             }
         }
     }
+    //! Choose the KmerOccurrence bit layout that fits the complete input
+    /*! Batches only use subsets of the IDs and sequences, so the layout is valid for all of them.
+     * With a \c seedIndexFile, its stored occurrences determine the layout and the query genomes must fit */
+    void setOccurrenceLayout(IdentifierMapping const & idMap,
+                             tsl::hopscotch_map<size_t, size_t> const & sequenceLengths,
+                             SeedIndexFile const * seedIndexFile = nullptr) {
+        size_t maxSequenceLength = 0;
+        for (auto&& elem : sequenceLengths) { maxSequenceLength = std::max(maxSequenceLength, elem.second); }
+        auto layout = KmerOccurrence::fitLayout(idMap.numGenomes(), idMap.numSequences(), maxSequenceLength);
+        if (seedIndexFile) {
+            layout = seedIndexFile->layout();
+            if (idMap.numGenomes() > layout.maxGenomeID() + 1 || idMap.numSequences() > layout.maxSequenceID() + 1
+                    || maxSequenceLength > layout.maxPosition() / 2) {  // one spare position bit, see KmerOccurrence::fitLayout()
+                throw std::runtime_error("[ERROR] -- SeedFinder::setOccurrenceLayout -- Query genomes do not fit the occurrence layout of the seed index");
+            }
+        }
+        KmerOccurrence::setLayout(layout);
+        if (!(layout == KmerOccurrence::compactLayout())) {
+            std::cout << "[INFO] -- Input exceeds the default occurrence layout, using genome/sequence/position bits "
+                      << layout << std::endl;
+        }
+        std::stringstream layoutString;
+        layoutString << layout;
+        output_->addRunInfo("occurrenceLayout", layoutString.str());
+    }
     //! Fill idMap and sequenceLengths map from a FastaCollection
     void fillIDMapSequenceLengths(FastaCollection const & fastaCollection,
                                   IdentifierMapping & idMap,
@@ -473,6 +554,13 @@ private:
         fastaCollection.populateIdentifierMappingFromFastaCollection(idMap);
         fastaCollection.fillSequenceLengths(sequenceLengths, idMap);
     }
+    //! Fill idMap and sequenceLengths map from a FastaCollectionView
+    void fillIDMapSequenceLengths(FastaCollectionView const & fastaCollection,
+                                  IdentifierMapping & idMap,
+                                  tsl::hopscotch_map<size_t, size_t> & sequenceLengths) const {
+        fastaCollection.populateIdentifierMapping(idMap);
+        fastaCollection.fillSequenceLengths(sequenceLengths, idMap);
+    }
     // Split input fasta files into equal parts and create batches of sequence IDs
     auto getFastaBatches(IdentifierMapping const & idMap) const {
         tsl::hopscotch_map<size_t, std::vector<size_t>> gidToSid;
@@ -501,9 +589,25 @@ private:
         }
         return batchVector;
     }
-    //! Load input fastas from disk into FastaCollection
-    auto loadFastas() {
-        auto fastaCollection = std::make_shared<FastaCollection>(config_);   // create all FastaRepresentations, including the artificial ones
+    //! Load input fastas from disk into FastaCollection, fill idMap and sequenceLengths map
+    /*! If '--genome-cache' is set and the cache matches the input, the genomes are loaded from the cache,
+     * otherwise the fasta files are parsed and the cache is (re-)created */
+    std::shared_ptr<FastaCollection> loadFastas(IdentifierMapping & idMap,
+                                                tsl::hopscotch_map<size_t, size_t> & sequenceLengths) {
+        GenomeCache cache(config_);
+        std::shared_ptr<FastaCollection> fastaCollection;
+        if (cache.valid()) {
+            std::cout << "[INFO] -- Loading genomes from cache " << config_->genomeCache() << std::endl;
+            fastaCollection = cache.load(idMap, sequenceLengths);
+        } else {
+            fastaCollection = std::make_shared<FastaCollection>(config_);   // create all FastaRepresentations, including the artificial ones
+            output_->addRunInfo("genomeLoadTime", fastaCollection->loadTimes());
+            fillIDMapSequenceLengths(*fastaCollection, idMap, sequenceLengths);
+            if (cache.enabled()) {
+                std::cout << "[INFO] -- Writing genome cache " << config_->genomeCache() << std::endl;
+                cache.write(*fastaCollection, idMap);
+            }
+        }
         std::cout << "[INFO] -- Total number of sequences: " << fastaCollection->numSequences() << std::endl << std::endl;
         output_->outputArtificialSequences(*fastaCollection);
         return fastaCollection;
@@ -514,6 +618,7 @@ private:
     std::mutex mutexOutput_;
     std::shared_ptr<Output> output_;
     bool parallelSeedMap_;
+    std::shared_ptr<SeedIndex<TwoBitSeedDataType> const> persistedIndex_;
     bool const pipelineA_;
 };
 
@@ -0,0 +1,639 @@
+#ifndef SEEDINDEX_H
+#define SEEDINDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "CacheFile.h"
+#include "KmerOccurrence.h"
+#include "ParallelizationUtils.h"
+#include "PostingCodec.h"
+#include "Prefetch.h"
+#include "TwoBitKmer.h"
+
+
+
+//! A seed occurrence as emitted by seed extraction, before it is placed into an index
+template <typename TwoBitSeedDataType>
+struct SeedRecord {
+    SeedRecord(TwoBitKmer<TwoBitSeedDataType> const & seed, KmerOccurrence const & occurrence, size_t maskIndex)
+        : seed{seed}, occurrence{occurrence}, maskIndex{maskIndex} {}
+    TwoBitKmer<TwoBitSeedDataType> seed;
+    KmerOccurrence occurrence;
+    size_t maskIndex;
+};
+
+
+
+class CompressedPostings;
+
+
+
+//! Occurrences of a single seed, one OccurrenceRange for each mask
+/*! Either views the occurrence vectors of a hash map based SeedMap or a row of a SeedIndex,
+ * a default constructed object represents a seed that is not present.
+ *
+ * Compressed rows of a SeedIndex are decoded into a buffer of this object, the range returned by \c at()
+ * for such a row is valid until the next call of \c at() */
+class SeedOccurrences {
+public:
+    //! c'tor (1)
+    /*! \details Seed without occurrences */
+    SeedOccurrences()
+        : decoded_{}, nMasks_{0}, occurrences_{nullptr}, offsets_{nullptr}, postings_{nullptr}, row_{0}, vectors_{nullptr} {}
+    //! c'tor (2)
+    /*! \param perMask One occurrence vector for each mask, must outlive this object */
+    SeedOccurrences(std::vector<std::vector<KmerOccurrence>> const & perMask)
+        : decoded_{}, nMasks_{perMask.size()}, occurrences_{nullptr}, offsets_{nullptr}, postings_{nullptr}, row_{0}, vectors_{&perMask} {}
+    //! c'tor (3)
+    /*! \param occurrences Packed occurrences of a SeedIndex
+     * \param offsets Row of \c nMasks + 1 offsets into \c occurrences, offsets of compressed rows are marked
+     *                with CompressedPostings::compressedRow
+     * \param nMasks Number of masks
+     * \param postings Compressed rows of the SeedIndex, \c nullptr if there are none
+     * \param row Row of the first mask in \c postings */
+    SeedOccurrences(KmerOccurrence const * occurrences, size_t const * offsets, size_t nMasks,
+                    CompressedPostings const * postings = nullptr, size_t row = 0)
+        : decoded_{}, nMasks_{nMasks}, occurrences_{occurrences}, offsets_{offsets}, postings_{postings}, row_{row}, vectors_{nullptr} {}
+    //! Copies view the same occurrences
+    SeedOccurrences(SeedOccurrences const &) = default;
+    SeedOccurrences(SeedOccurrences &&) = default;
+    SeedOccurrences & operator=(SeedOccurrences const &) = default;
+    SeedOccurrences & operator=(SeedOccurrences &&) = default;
+    //! Return the occurrences of the seed of mask \c maskID, empty if the seed is not present
+    OccurrenceRange at(size_t maskID) const;
+    //! Returns \c true if the seed is present
+    bool found() const { return vectors_ || offsets_; }
+    //! Number of masks
+    size_t size() const { return nMasks_; }
+
+private:
+    mutable std::vector<KmerOccurrence> decoded_;
+    size_t nMasks_;
+    KmerOccurrence const * occurrences_;
+    size_t const * offsets_;
+    CompressedPostings const * postings_;
+    size_t row_;
+    std::vector<std::vector<KmerOccurrence>> const * vectors_;
+};
+
+
+
+//! Read-only array of a SeedIndex that either owns its elements or views elements stored elsewhere
+/*! Views are used for indices that are loaded from a memory mapped file, \c owner_ keeps the mapping alive */
+template <typename T>
+class IndexArray {
+public:
+    //! c'tor (1)
+    /*! \param elements Owned elements */
+    IndexArray(std::vector<T> && elements = {})
+        : data_{nullptr}, elements_{std::move(elements)}, owner_{}, size_{elements_.size()} { data_ = elements_.data(); }
+    //! c'tor (2)
+    /*! \param data First of \c size elements that are used in place
+     * \param size Number of elements
+     * \param owner Keeps the storage of \c data alive */
+    IndexArray(T const * data, size_t size, std::shared_ptr<void const> owner)
+        : data_{data}, elements_{}, owner_{owner}, size_{size} {}
+    //! Copies share external storage, if any
+    IndexArray(IndexArray const & other)
+        : data_{other.data_}, elements_{other.elements_}, owner_{other.owner_}, size_{other.size_} {
+        if (!owner_) { data_ = elements_.data(); }
+    }
+    //! Moving a vector keeps its storage, so \c data_ stays valid
+    IndexArray(IndexArray && other) = default;
+    IndexArray & operator=(IndexArray const & other) {
+        IndexArray copy(other);
+        return *this = std::move(copy);
+    }
+    IndexArray & operator=(IndexArray && other) = default;
+    //! Access element \c i
+    T const & operator[](size_t i) const { return data_[i]; }
+    //! Iterator to the first element
+    T const * begin() const { return data_; }
+    //! Pointer to the first element
+    T const * data() const { return data_; }
+    //! Iterator behind the last element
+    T const * end() const { return data_ + size_; }
+    //! Memory owned by this array in bytes, external storage is not counted
+    size_t objectSize() const { return elements_.capacity() * sizeof(T); }
+    //! Number of elements
+    size_t size() const { return size_; }
+
+private:
+    //! First element, either in \c elements_ or in external storage
+    T const * data_;
+    //! Owned elements, empty if external storage is used
+    std::vector<T> elements_;
+    //! Owner of the external storage, if any
+    std::shared_ptr<void const> owner_;
+    //! Number of elements
+    size_t size_;
+};
+
+
+
+//! Rows of a SeedIndex whose occurrences are stored with PostingCodec ('--compress-postings')
+/*! A row is a seed and a mask, rows are sorted, the posting of row \c rows_[i] are the bytes
+ * [\c starts_[i], \c starts_[i + 1]) of \c bytes_ */
+class CompressedPostings {
+public:
+    //! Flag of the SeedIndex offset of a compressed row, such that only these rows are searched in \c rows_
+    static constexpr size_t compressedRow = size_t{1} << 63;
+
+    //! c'tor (1)
+    /*! \details No compressed rows */
+    CompressedPostings() : bytes_{}, rows_{}, starts_{std::vector<size_t>{0}} {}
+    //! c'tor (2)
+    CompressedPostings(IndexArray<uint8_t> && bytes, IndexArray<size_t> && rows, IndexArray<size_t> && starts)
+        : bytes_{std::move(bytes)}, rows_{std::move(rows)}, starts_{std::move(starts)} {
+        if (starts_.size() != rows_.size() + 1 || starts_[rows_.size()] != bytes_.size()
+                || !std::is_sorted(rows_.begin(), rows_.end()) || !std::is_sorted(starts_.begin(), starts_.end())) {
+            throw std::runtime_error("[ERROR] -- CompressedPostings -- Inconsistent postings");
+        }
+    }
+    //! Decode the posting of \c row into \c occurrences, returns \c false if \c row is not compressed
+    bool decode(size_t row, std::vector<KmerOccurrence> & occurrences) const {
+        auto it = std::lower_bound(rows_.begin(), rows_.end(), row);
+        if (it == rows_.end() || *it != row) { return false; }
+        auto i = static_cast<size_t>(it - rows_.begin());
+        PostingCodec::decode(bytes_.data() + starts_[i], bytes_.data() + starts_[i + 1], occurrences);
+        return true;
+    }
+    //! Getter for member \c bytes_
+    auto const & bytes() const { return bytes_; }
+    //! Returns \c true if there are no compressed rows
+    bool empty() const { return rows_.size() == 0; }
+    //! Memory owned by the postings in bytes
+    size_t objectSize() const { return bytes_.objectSize() + rows_.objectSize() + starts_.objectSize(); }
+    //! Getter for member \c rows_
+    auto const & rows() const { return rows_; }
+    //! Number of compressed rows
+    size_t size() const { return rows_.size(); }
+    //! Getter for member \c starts_
+    auto const & starts() const { return starts_; }
+
+private:
+    //! Postings of all compressed rows
+    IndexArray<uint8_t> bytes_;
+    //! Compressed rows in ascending order
+    IndexArray<size_t> rows_;
+    //! Offset of the posting of each compressed row in \c bytes_, plus the total
+    IndexArray<size_t> starts_;
+};
+
+
+
+inline OccurrenceRange SeedOccurrences::at(size_t maskID) const {
+    if (vectors_) { return OccurrenceRange(vectors_->at(maskID)); }
+    if (offsets_) {
+        auto first = offsets_[maskID];
+        if (first & CompressedPostings::compressedRow) {
+            if (postings_ && postings_->decode(row_ + maskID, decoded_)) { return OccurrenceRange(decoded_); }
+            return OccurrenceRange();
+        }
+        return OccurrenceRange(occurrences_ + first, occurrences_ + (offsets_[maskID + 1] & ~CompressedPostings::compressedRow));
+    }
+    return OccurrenceRange();
+}
+
+
+
+//! Seed map in compressed sparse row layout, built by sorting all seed occurrences at once
+/*! Stores the unique seeds, the occurrences of all seeds and masks packed in \c occurrences_
+ * and for each seed and mask the offset of its first occurrence in \c offsets_. Compared to a hash map
+ * of per-mask occurrence vectors, this needs no heap allocation and no vector headers per seed.
+ *
+ * Seeds are grouped by their first \c prefixLength_ bases, which index a direct-address table of
+ * key offsets (\c prefixStarts_). Only the remaining bases of each seed are stored, packed in 32 bit
+ * words, and a lookup is a binary search over the suffixes of a single prefix bucket, without hashing.
+ * The prefix length is '--max-prefix-length', reduced such that the table has at most one entry per
+ * eight seed occurrences, i.e. it never dominates the memory consumption.
+ *
+ * The index is built from per-thread record buffers: a parallel radix pass scatters the records into
+ * partitions of consecutive prefixes, then each partition is sorted by prefix, suffix and mask.
+ *
+ * With a compression threshold, rows (seed and mask) with at least that many occurrences are moved from
+ * \c occurrences_ to \c postings_, coded by PostingCodec, and their offsets are marked with
+ * CompressedPostings::compressedRow. Rows of unique seeds stay uncompressed.
+ *
+ * An index can be written to a file and read back in place from a memory mapping (\c write(), \c read()),
+ * then all arrays view the mapped file and lookups only touch the pages they need. */
+template <typename TwoBitSeedDataType>
+class SeedIndex {
+public:
+    using Record = SeedRecord<TwoBitSeedDataType>;
+
+    //! c'tor
+    /*! \details Creates an empty index */
+    SeedIndex()
+        : nKeys_{0}, nMasks_{0}, occurrences_{}, offsets_{std::vector<size_t>{0}}, postings_{}, prefixLength_{0},
+          prefixStarts_{std::vector<size_t>{0, 0}}, seedLength_{0}, suffixes_{}, suffixWords_{0} {}
+
+    //! Build the index from record buffers
+    /*! \param buffers Records, e.g. one buffer per extraction thread. Buffers are released while building
+     * \param nMasks Number of masks, all \c maskIndex values must be smaller
+     * \param maxPrefixLength Upper bound for the number of bases that index the prefix table
+     * \param nThreads Number of threads to use
+     * \param compressionThreshold Rows with at least this many occurrences are compressed, 0 for none
+     *
+     * \details All seeds must have the same length */
+    void build(std::vector<std::vector<Record>> && buffers, size_t nMasks, size_t maxPrefixLength, size_t nThreads,
+               size_t compressionThreshold = 0) {
+        clear();
+        nMasks_ = nMasks;
+        size_t total = 0;
+        Record const * first = nullptr;
+        for (auto&& buffer : buffers) {
+            total += buffer.size();
+            if (buffer.size() && !first) { first = &buffer.front(); }
+        }
+        if (total == 0) { return; }
+        auto placeholder = *first;  // initial value of the output vectors, buffers are released during the build
+        seedLength_ = placeholder.seed.length();
+        for (auto&& buffer : buffers) {
+            for (auto&& record : buffer) {
+                if (record.seed.length() != seedLength_) { throw std::runtime_error("[ERROR] -- SeedIndex::build -- All seeds must have the same length"); }
+            }
+        }
+        prefixLength_ = prefixLengthFor(total, seedLength_, maxPrefixLength);
+        suffixWords_ = (seedLength_ - prefixLength_ + 15) / 16;
+        nThreads = std::max<size_t>(nThreads, 1);
+        auto partitionBits = std::min<size_t>(2 * prefixLength_, 12);
+        auto partitionShift = 2 * prefixLength_ - partitionBits;
+        size_t nPartitions = size_t{1} << partitionBits;
+        std::vector<size_t> bufferIDs(buffers.size());
+        std::iota(bufferIDs.begin(), bufferIDs.end(), 0);
+        std::vector<size_t> partitionIDs(nPartitions);
+        std::iota(partitionIDs.begin(), partitionIDs.end(), 0);
+
+        // radix pass: count records per buffer and partition, then scatter them into the partition ranges
+        std::vector<std::vector<size_t>> counts(buffers.size(), std::vector<size_t>(nPartitions, 0));
+        auto count = [this, &buffers, &counts, partitionShift](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            for (; it != end; ++it) {
+                for (auto&& record : buffers[*it]) { ++counts[*it][prefix(record.seed) >> partitionShift]; }
+            }
+        };
+        executeParallel(bufferIDs, nThreads, count);
+        std::vector<size_t> recordStarts(nPartitions + 1, 0);   // first record of each partition
+        size_t position = 0;
+        for (size_t b = 0; b < nPartitions; ++b) {
+            recordStarts[b] = position;
+            for (size_t t = 0; t < buffers.size(); ++t) {
+                auto n = counts[t][b];
+                counts[t][b] = position;    // from now on: write position of buffer t in partition b
+                position += n;
+            }
+        }
+        recordStarts[nPartitions] = position;
+        std::vector<Record> records(total, placeholder);
+        auto scatter = [this, &buffers, &counts, &records, partitionShift](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            for (; it != end; ++it) {
+                for (auto&& record : buffers[*it]) { records[counts[*it][prefix(record.seed) >> partitionShift]++] = record; }
+                std::vector<Record>().swap(buffers[*it]);
+            }
+        };
+        executeParallel(bufferIDs, nThreads, scatter);
+
+        // sort each partition by prefix, suffix and mask, count unique seeds per partition
+        std::vector<size_t> keyCounts(nPartitions, 0);
+        auto sortPartitions = [this, &records, &recordStarts, &keyCounts](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            for (; it != end; ++it) {
+                auto first = records.begin() + recordStarts[*it];
+                auto last = records.begin() + recordStarts[*it + 1];
+                // for equal prefixes, the order of the seeds is the order of their suffixes
+                std::sort(first, last, [this](Record const & lhs, Record const & rhs) {
+                    auto lhsPrefix = prefix(lhs.seed);
+                    auto rhsPrefix = prefix(rhs.seed);
+                    if (lhsPrefix != rhsPrefix) { return lhsPrefix < rhsPrefix; }
+                    return (lhs.seed == rhs.seed) ? lhs.maskIndex < rhs.maskIndex : lhs.seed < rhs.seed;
+                });
+                for (auto r = first; r != last; ++r) {
+                    if (r == first || !(r->seed == std::prev(r)->seed)) { ++keyCounts[*it]; }
+                }
+            }
+        };
+        executeParallel(partitionIDs, nThreads, sortPartitions);
+        std::vector<size_t> keyStarts(nPartitions + 1, 0);
+        for (size_t b = 0; b < nPartitions; ++b) { keyStarts[b + 1] = keyStarts[b] + keyCounts[b]; }
+
+        // fill prefix table, suffixes, offsets and packed occurrences
+        nKeys_ = keyStarts[nPartitions];
+        std::vector<size_t> prefixStarts((size_t{1} << (2 * prefixLength_)) + 1, 0);
+        prefixStarts.back() = nKeys_;
+        std::vector<uint32_t> suffixes(nKeys_ * suffixWords_, 0);
+        std::vector<size_t> offsets(nKeys_ * nMasks_ + 1, 0);
+        offsets[nKeys_ * nMasks_] = total;
+        std::vector<KmerOccurrence> occurrences(total, placeholder.occurrence);
+        auto fill = [this, &records, &recordStarts, &keyStarts, &prefixStarts, &suffixes, &offsets, &occurrences,
+                     partitionShift](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            for (; it != end; ++it) {
+                auto key = keyStarts[*it];
+                auto nextPrefix = *it << partitionShift;
+                auto endPrefix = (*it + 1) << partitionShift;
+                auto r = recordStarts[*it];
+                auto last = recordStarts[*it + 1];
+                while (r < last) {
+                    auto runEnd = r;
+                    while (runEnd < last && records[runEnd].seed == records[r].seed) { ++runEnd; }
+                    auto const & seed = records[r].seed;
+                    for (auto p = prefix(seed); nextPrefix <= p; ++nextPrefix) { prefixStarts[nextPrefix] = key; }
+                    for (size_t j = 0; j < suffixWords_; ++j) { suffixes[key * suffixWords_ + j] = suffixWord(seed, j); }
+                    auto m = r;
+                    for (size_t maskID = 0; maskID < nMasks_; ++maskID) {
+                        while (m < runEnd && records[m].maskIndex < maskID) { ++m; }
+                        offsets[key * nMasks_ + maskID] = m;
+                    }
+                    for (; r < runEnd; ++r) { occurrences[r] = records[r].occurrence; }
+                    ++key;
+                }
+                for (; nextPrefix < endPrefix; ++nextPrefix) { prefixStarts[nextPrefix] = key; }
+            }
+        };
+        executeParallel(partitionIDs, nThreads, fill);
+        if (compressionThreshold > 0) { compressRows(compressionThreshold, nThreads, offsets, occurrences); }
+        occurrences_ = IndexArray<KmerOccurrence>(std::move(occurrences));
+        offsets_ = IndexArray<size_t>(std::move(offsets));
+        prefixStarts_ = IndexArray<size_t>(std::move(prefixStarts));
+        suffixes_ = IndexArray<uint32_t>(std::move(suffixes));
+    }
+    //! Remove all seeds and release the memory
+    void clear() {
+        nKeys_ = 0;
+        occurrences_ = IndexArray<KmerOccurrence>();
+        offsets_ = IndexArray<size_t>(std::vector<size_t>{0});
+        postings_ = CompressedPostings();
+        prefixLength_ = 0;
+        prefixStarts_ = IndexArray<size_t>(std::vector<size_t>{0, 0});
+        seedLength_ = 0;
+        suffixes_ = IndexArray<uint32_t>();
+        suffixWords_ = 0;
+    }
+    //! Return the occurrences of \c seed, SeedOccurrences::found() is \c false if the seed is not present
+    SeedOccurrences find(TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        if (seed.length() != seedLength_) { return SeedOccurrences(); }
+        auto i = findKey(seed, prefix(seed));
+        return (i == nKeys_) ? SeedOccurrences() : row(i);
+    }
+    //! Batched \c find(), sets \c occurrences[i] to the occurrences of \c seeds[i]
+    /*! Works in stages over blocks of \c prefetchBlockSize seeds: prefetch the prefix table entries,
+     * then the first suffix of each binary search, then search and prefetch the offsets of the found keys */
+    void find(std::vector<TwoBitKmer<TwoBitSeedDataType>> const & seeds, std::vector<SeedOccurrences> & occurrences) const {
+        occurrences.assign(seeds.size(), SeedOccurrences());
+        std::array<size_t, prefetchBlockSize> prefixes{};
+        std::array<size_t, prefetchBlockSize> keys{};
+        for (size_t block = 0; block < seeds.size(); block += prefetchBlockSize) {
+            auto n = std::min(prefetchBlockSize, seeds.size() - block);
+            for (size_t i = 0; i < n; ++i) {
+                prefixes[i] = (seeds[block + i].length() == seedLength_) ? prefix(seeds[block + i]) : prefixStarts_.size();
+                if (prefixes[i] < prefixStarts_.size()) { prefetch(&prefixStarts_[prefixes[i]]); }
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (prefixes[i] == prefixStarts_.size()) { continue; }
+                auto first = prefixStarts_[prefixes[i]];
+                auto last = prefixStarts_[prefixes[i] + 1];
+                if (first < last) { prefetch(&suffixes_[(first + (last - first) / 2) * suffixWords_]); }
+            }
+            for (size_t i = 0; i < n; ++i) {
+                keys[i] = (prefixes[i] == prefixStarts_.size()) ? nKeys_ : findKey(seeds[block + i], prefixes[i]);
+                if (keys[i] < nKeys_) { prefetch(&offsets_[keys[i] * nMasks_]); }
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (keys[i] < nKeys_) { occurrences[block + i] = row(keys[i]); }
+            }
+        }
+    }
+    //! Call \c function(seed, SeedOccurrences) for each seed in the index
+    template <typename F>
+    void forEach(F function) const { forEachInRange(0, nKeys_, function); }
+    //! Call \c function(seed, SeedOccurrences) for the seeds with indices in [\c first, \c last)
+    template <typename F>
+    void forEachInRange(size_t first, size_t last, F function) const {
+        last = std::min(last, nKeys_);
+        if (first >= last) { return; }
+        // last prefix bucket that starts at or before first, i.e. the non-empty bucket that contains it
+        auto p = static_cast<size_t>(std::upper_bound(prefixStarts_.begin(), prefixStarts_.end(), first) - prefixStarts_.begin()) - 1;
+        std::vector<uint64_t> words(seedLength_ / 32 + 2, 0);
+        for (auto i = first; i < last; ++i) {
+            while (prefixStarts_[p + 1] <= i) { ++p; }
+            function(key(i, p, words), row(i));
+        }
+    }
+    //! Memory consumption of the index in bytes
+    size_t objectSize() const {
+        return sizeof(*this) + occurrences_.objectSize() + offsets_.objectSize() + postings_.objectSize()
+               + prefixStarts_.objectSize() + suffixes_.objectSize();
+    }
+    //! Getter for member \c nMasks_
+    auto numMasks() const { return nMasks_; }
+    //! Getter for member \c postings_
+    auto const & postings() const { return postings_; }
+    //! Getter for member \c prefixLength_
+    auto prefixLength() const { return prefixLength_; }
+    //! Replace the index by one written with \c write(), the arrays are used in place
+    /*! \param reader Positioned at the index, e.g. on a memory mapped file
+     * \param owner Keeps the storage of \c reader alive as long as the index uses it */
+    void read(CacheReader & reader, std::shared_ptr<void const> owner) {
+        clear();
+        nKeys_ = reader.u64();
+        nMasks_ = reader.u64();
+        prefixLength_ = reader.u64();
+        seedLength_ = reader.u64();
+        suffixWords_ = reader.u64();
+        occurrences_ = readArray<KmerOccurrence>(reader, owner);
+        offsets_ = readArray<size_t>(reader, owner);
+        prefixStarts_ = readArray<size_t>(reader, owner);
+        suffixes_ = readArray<uint32_t>(reader, owner);
+        auto postingBytes = readArray<uint8_t>(reader, owner);
+        auto postingRows = readArray<size_t>(reader, owner);
+        auto postingStarts = readArray<size_t>(reader, owner);
+        postings_ = CompressedPostings(std::move(postingBytes), std::move(postingRows), std::move(postingStarts));
+        if ((!postings_.empty() && postings_.rows()[postings_.size() - 1] >= nKeys_ * nMasks_) || prefixLength_ > 16 || prefixStarts_.size() != (size_t{1} << (2 * prefixLength_)) + 1
+                || offsets_.size() != nKeys_ * nMasks_ + 1 || suffixes_.size() != nKeys_ * suffixWords_
+                || prefixStarts_[prefixStarts_.size() - 1] != nKeys_ || offsets_[offsets_.size() - 1] != occurrences_.size()) {
+            throw std::runtime_error("[ERROR] -- SeedIndex::read -- Inconsistent seed index");
+        }
+    }
+    //! SeedOccurrences of the seed with index \c i, i.e. the i-th smallest seed
+    SeedOccurrences row(size_t i) const {
+        return SeedOccurrences(occurrences_.data(), &offsets_[i * nMasks_], nMasks_, postings_.empty() ? nullptr : &postings_, i * nMasks_);
+    }
+    //! Batched \c row(), sets \c occurrences to the SeedOccurrences of the seeds with indices [\c first, \c last)
+    /*! Prefetches the offsets of a block of seeds, then the first occurrence of each */
+    void rows(std::vector<uint64_t>::const_iterator first, std::vector<uint64_t>::const_iterator last,
+              std::vector<SeedOccurrences> & occurrences) const {
+        occurrences.clear();
+        while (first != last) {
+            auto blockEnd = first + static_cast<std::ptrdiff_t>(std::min<size_t>(prefetchBlockSize, static_cast<size_t>(last - first)));
+            for (auto it = first; it != blockEnd; ++it) { prefetch(&offsets_[*it * nMasks_]); }
+            for (auto it = first; it != blockEnd; ++it) {
+                auto offset = offsets_[*it * nMasks_];
+                if (offset < occurrences_.size()) { prefetch(&occurrences_[offset]); }
+            }
+            for (; first != blockEnd; ++first) { occurrences.emplace_back(row(*first)); }
+        }
+    }
+    //! Getter for member \c seedLength_
+    auto seedLength() const { return seedLength_; }
+    //! Number of unique seeds
+    size_t size() const { return nKeys_; }
+    //! Write the index such that \c read() can use it in place
+    void write(CacheWriter & writer) const {
+        writer.u64(nKeys_);
+        writer.u64(nMasks_);
+        writer.u64(prefixLength_);
+        writer.u64(seedLength_);
+        writer.u64(suffixWords_);
+        writer.array(occurrences_.data(), occurrences_.size());
+        writer.array(offsets_.data(), offsets_.size());
+        writer.array(prefixStarts_.data(), prefixStarts_.size());
+        writer.array(suffixes_.data(), suffixes_.size());
+        writer.array(postings_.bytes().data(), postings_.bytes().size());
+        writer.array(postings_.rows().data(), postings_.rows().size());
+        writer.array(postings_.starts().data(), postings_.starts().size());
+    }
+
+private:
+    //! Move all rows with at least \c threshold occurrences from \c occurrences into \c postings_, adjusting \c offsets
+    /*! The rows are encoded in parallel chunks, then the remaining occurrences are compacted in place and the
+     * offsets of the compressed rows are marked */
+    void compressRows(size_t threshold, size_t nThreads, std::vector<size_t> & offsets, std::vector<KmerOccurrence> & occurrences) {
+        auto nRows = nKeys_ * nMasks_;
+        auto nChunks = 4 * nThreads;
+        std::vector<size_t> chunkIDs(nChunks);
+        std::iota(chunkIDs.begin(), chunkIDs.end(), 0);
+        std::vector<std::vector<uint8_t>> chunkBytes(nChunks);
+        std::vector<std::vector<size_t>> chunkRows(nChunks);
+        std::vector<std::vector<size_t>> chunkStarts(nChunks);
+        auto encode = [&](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            std::vector<KmerOccurrence> scratch;
+            for (; it != end; ++it) {
+                for (auto r = nRows * *it / nChunks; r < nRows * (*it + 1) / nChunks; ++r) {
+                    if (offsets[r + 1] - offsets[r] < threshold) { continue; }
+                    chunkRows[*it].emplace_back(r);
+                    chunkStarts[*it].emplace_back(chunkBytes[*it].size());
+                    PostingCodec::encode(OccurrenceRange(occurrences.data() + offsets[r], occurrences.data() + offsets[r + 1]),
+                                         scratch, chunkBytes[*it]);
+                }
+            }
+        };
+        executeParallel(chunkIDs, nThreads, encode);
+        std::vector<uint8_t> bytes;
+        std::vector<size_t> rows;
+        std::vector<size_t> starts;
+        for (size_t c = 0; c < nChunks; ++c) {
+            for (auto start : chunkStarts[c]) { starts.emplace_back(bytes.size() + start); }
+            rows.insert(rows.end(), chunkRows[c].begin(), chunkRows[c].end());
+            bytes.insert(bytes.end(), chunkBytes[c].begin(), chunkBytes[c].end());
+            std::vector<uint8_t>().swap(chunkBytes[c]);
+        }
+        starts.emplace_back(bytes.size());
+        // offsets[r] is overwritten only after the old value was read, offsets[r + 1] is still the old value
+        size_t write = 0;
+        size_t nextCompressed = 0;
+        for (size_t r = 0; r < nRows; ++r) {
+            auto first = offsets[r];
+            auto last = offsets[r + 1];
+            offsets[r] = write;
+            if (nextCompressed < rows.size() && rows[nextCompressed] == r) {
+                offsets[r] |= CompressedPostings::compressedRow;
+                ++nextCompressed;
+                continue;
+            }
+            for (auto i = first; i < last; ++i) { occurrences[write++] = occurrences[i]; }
+        }
+        offsets[nRows] = write;
+        occurrences.erase(occurrences.begin() + static_cast<std::ptrdiff_t>(write), occurrences.end());
+        occurrences.shrink_to_fit();
+        postings_ = CompressedPostings(IndexArray<uint8_t>(std::move(bytes)), IndexArray<size_t>(std::move(rows)),
+                                       IndexArray<size_t>(std::move(starts)));
+    }
+    //! Compare the stored suffix of key \c i with the suffix of \c seed, returns -1, 0 or 1
+    int compareSuffix(size_t i, TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        for (auto j = suffixWords_; j > 0; --j) {   // highest word first, like TwoBitKmer::operator<
+            auto stored = suffixes_[i * suffixWords_ + j - 1];
+            auto query = suffixWord(seed, j - 1);
+            if (stored != query) { return (stored < query) ? -1 : 1; }
+        }
+        return 0;
+    }
+    //! Index of \c seed with prefix \c p, \c nKeys_ if the seed is not present
+    size_t findKey(TwoBitKmer<TwoBitSeedDataType> const & seed, size_t p) const {
+        auto first = prefixStarts_[p];
+        auto last = prefixStarts_[p + 1];
+        while (first < last) {   // lower bound of the suffix
+            auto mid = first + (last - first) / 2;
+            if (compareSuffix(mid, seed) < 0) { first = mid + 1; } else { last = mid; }
+        }
+        return (first == prefixStarts_[p + 1] || compareSuffix(first, seed) != 0) ? nKeys_ : first;
+    }
+    //! Restore seed \c i with prefix \c p, \c words is a zeroed buffer of at least <tt>seedLength_ / 32 + 2</tt> words
+    TwoBitKmer<TwoBitSeedDataType> key(size_t i, size_t p, std::vector<uint64_t> & words) const {
+        std::fill(words.begin(), words.end(), 0);
+        words[0] = p;
+        for (size_t j = 0; j < suffixWords_; ++j) {
+            uint64_t suffix = suffixes_[i * suffixWords_ + j];
+            auto offset = 2 * prefixLength_ + 32 * j;
+            words[offset / 64] |= suffix << (offset % 64);
+            if (offset % 64 > 32) { words[offset / 64 + 1] |= suffix >> (64 - offset % 64); }
+        }
+        return TwoBitKmer<TwoBitSeedDataType>(words.data(), seedLength_);
+    }
+    //! Prefix bucket of \c seed, i.e. the two bit codes of its first \c prefixLength_ bases
+    size_t prefix(TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        return static_cast<size_t>(seed.bases(0) & ((uint64_t{1} << (2 * prefixLength_)) - 1));
+    }
+    //! Number of prefix bases, such that the prefix table has at most one entry per eight records
+    static size_t prefixLengthFor(size_t nRecords, size_t seedLength, size_t maxPrefixLength) {
+        auto length = std::min<size_t>({maxPrefixLength, seedLength, 16});
+        while (length > 0 && (size_t{1} << (2 * length)) > nRecords / 8) { --length; }
+        return length;
+    }
+    //! Array of the next record of \c reader, used in place
+    template <typename T>
+    static IndexArray<T> readArray(CacheReader & reader, std::shared_ptr<void const> owner) {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= 8, "Elements must be trivially copyable and 8 byte aligned in the file");
+        size_t size = 0;
+        auto data = reader.array<T>(size);
+        return IndexArray<T>(data, size, owner);
+    }
+    //! Word \c j of the suffix of \c seed, i.e. the bases behind the prefix packed in 32 bit words
+    uint32_t suffixWord(TwoBitKmer<TwoBitSeedDataType> const & seed, size_t j) const {
+        auto offset = 2 * prefixLength_ + 32 * j;
+        auto w = offset / 64;
+        auto shift = offset % 64;
+        auto value = seed.bases(w) >> shift;
+        if (shift > 32 && w + 1 < seed.basesWordCount()) { value |= seed.bases(w + 1) << (64 - shift); }
+        return static_cast<uint32_t>(value);
+    }
+
+    //! Number of unique seeds
+    size_t nKeys_;
+    //! Number of masks
+    size_t nMasks_;
+    //! Occurrences of all seeds, ordered by seed and mask
+    IndexArray<KmerOccurrence> occurrences_;
+    //! Offset of the first occurrence of seed \c i and mask \c m at <tt>i * nMasks_ + m</tt>, plus the total
+    IndexArray<size_t> offsets_;
+    //! Rows with many occurrences, their ranges in \c offsets_ are empty
+    CompressedPostings postings_;
+    //! Number of leading bases that select a prefix bucket
+    size_t prefixLength_;
+    //! Index of the first key of each prefix, plus the total number of keys
+    IndexArray<size_t> prefixStarts_;
+    //! Length of all seeds in the index
+    size_t seedLength_;
+    //! Bases behind the prefix of each key, \c suffixWords_ words per key with the lowest word first
+    IndexArray<uint32_t> suffixes_;
+    //! Number of 32 bit words per suffix
+    size_t suffixWords_;
+};
+
+#endif // SEEDINDEX_H
@@ -0,0 +1,159 @@
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "SeedIndexFile.h"
+
+
+
+namespace {
+
+//! Magic bytes at the beginning of each seed index file
+constexpr char indexMagic[8] = {'G', 'H', 'S', 'E', 'E', 'D', 'I', 'X'};
+
+} // namespace
+
+
+
+SeedIndexFile::SeedIndexFile(fs::path const & path)
+    : canonicalSeeds_{false}, file_{std::make_shared<MappedFile const>(path.string(), MADV_RANDOM)},   // lookups touch scattered pages
+      genomeNames_{}, indexOffset_{0}, layout_{KmerOccurrence::compactLayout()}, masks_{}, minimizerWindow_{1}, path_{path},
+      redmask_{false}, referenceSampling_{1}, sequences_{}, thinning_{1} {
+    CacheReader reader(file_->data(), file_->size());
+    auto magic = reader.bytes(sizeof(indexMagic));
+    if (std::memcmp(magic, indexMagic, sizeof(indexMagic)) != 0) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- " + path_.string() + " is not a seed index file");
+    }
+    if (reader.u64() != formatVersion) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- Unsupported seed index format version in " + path_.string());
+    }
+    masks_.resize(reader.u64());
+    for (auto&& mask : masks_) { mask = reader.string(); }
+    canonicalSeeds_ = reader.u64();
+    minimizerWindow_ = reader.u64();
+    redmask_ = reader.u64();
+    referenceSampling_ = reader.u64();
+    thinning_ = reader.u64();
+    layout_.genomeBits = reader.u64();
+    layout_.sequenceBits = reader.u64();
+    layout_.positionBits = reader.u64();
+    genomeNames_.resize(reader.u64());
+    for (auto&& name : genomeNames_) { name = reader.string(); }
+    auto numSequences = reader.u64();
+    for (size_t sid = 0; sid < numSequences; ++sid) {
+        auto gid = reader.u64();
+        auto header = reader.string();
+        auto length = reader.u64();
+        if (gid >= genomeNames_.size()) {
+            throw std::runtime_error("[ERROR] -- SeedIndexFile -- Inconsistent genome IDs in " + path_.string());
+        }
+        sequences_.push_back(Sequence{gid, header, length});
+    }
+    indexOffset_ = reader.position();
+}
+
+
+
+void SeedIndexFile::checkCompatible(Configuration const & config) const {
+    if (config.maskCollection()->masksAsString() != masks_) {
+        std::string masks;
+        for (auto&& mask : masks_) { masks += mask + " "; }
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- Masks differ from the masks " + masks + "of " + path_.string());
+    }
+    if (config.canonicalSeeds() != canonicalSeeds_) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--canonical-seeds' differs from " + path_.string());
+    }
+    if (config.minimizerWindow() != minimizerWindow_) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--minimizer-window' differs from the window "
+                                 + std::to_string(minimizerWindow_) + " of " + path_.string());
+    }
+    if (config.redmask() != redmask_) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--redmask' differs from " + path_.string());
+    }
+    if (config.referenceSampling() != referenceSampling_) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--reference-sampling' differs from the sampling "
+                                 + std::to_string(referenceSampling_) + " of " + path_.string());
+    }
+    if (config.thinning() != thinning_) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--thinning' differs from the thinning "
+                                 + std::to_string(thinning_) + " of " + path_.string());
+    }
+}
+
+
+
+void SeedIndexFile::fillIdentifierMapping(IdentifierMapping & idMap, tsl::hopscotch_map<size_t, size_t> & sequenceLengths) const {
+    if (genomeNames_.size() < 2 || idMap.numGenomes() != 2 || idMap.numSequences() != 0) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile::fillIdentifierMapping -- Expected an empty mapping of reference and query genome");
+    }
+    if (idMap.queryGenomeName(0) != genomeNames_.at(0)) {
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- '--genome1' " + idMap.queryGenomeName(0)
+                                 + " is not the reference genome " + genomeNames_.at(0) + " of " + path_.string());
+    }
+    for (size_t gid = 2; gid < genomeNames_.size(); ++gid) {
+        if (idMap.queryGenomeID(genomeNames_.at(gid)) != gid) {
+            throw std::runtime_error("[ERROR] -- SeedIndexFile -- Query genome " + idMap.queryGenomeName(1)
+                                     + " is already part of " + path_.string());
+        }
+    }
+    sequenceLengths.reserve(sequenceLengths.size() + sequences_.size());
+    for (size_t sid = 0; sid < sequences_.size(); ++sid) {
+        auto& sequence = sequences_.at(sid);
+        if (sequence.gid == 1 || idMap.querySequenceID(sequence.header, genomeNames_.at(sequence.gid)) != sid) {
+            throw std::runtime_error("[ERROR] -- SeedIndexFile -- Inconsistent sequence IDs in " + path_.string());
+        }
+        sequenceLengths[sid] = sequence.length;
+    }
+}
+
+
+
+void SeedIndexFile::commit(CacheWriter & writer, fs::path const & tmpPath, fs::path const & path) {
+    auto success = writer.good();
+    writer.close();
+    if (!success) {
+        fs::remove(tmpPath);
+        throw std::runtime_error("[ERROR] -- SeedIndexFile -- Failed to write " + path.string());
+    }
+    fs::rename(tmpPath, path);
+}
+
+
+
+fs::path SeedIndexFile::temporaryPath(fs::path const & path) {
+    auto tmpPath = path;
+    tmpPath += ".tmp" + std::to_string(::getpid());
+    return tmpPath;
+}
+
+
+
+void SeedIndexFile::writeHeader(CacheWriter & writer,
+                                Configuration const & config,
+                                IdentifierMapping const & idMap,
+                                tsl::hopscotch_map<size_t, size_t> const & sequenceLengths) {
+    writer.bytes(indexMagic, sizeof(indexMagic));
+    writer.u64(formatVersion);
+    auto masks = config.maskCollection()->masksAsString();
+    writer.u64(masks.size());
+    for (auto&& mask : masks) { writer.string(mask); }
+    writer.u64(config.canonicalSeeds());
+    writer.u64(config.minimizerWindow());
+    writer.u64(config.redmask());
+    writer.u64(config.referenceSampling());
+    writer.u64(config.thinning());
+    auto& layout = KmerOccurrence::layout();
+    writer.u64(layout.genomeBits);
+    writer.u64(layout.sequenceBits);
+    writer.u64(layout.positionBits);
+    writer.u64(idMap.numGenomes());
+    for (size_t gid = 0; gid < idMap.numGenomes(); ++gid) { writer.string(idMap.queryGenomeName(gid)); }
+    writer.u64(idMap.numSequences());
+    for (size_t sid = 0; sid < idMap.numSequences(); ++sid) {
+        auto& tuple = idMap.querySequenceTuple(sid);
+        writer.u64(tuple.gid);
+        writer.string(tuple.sequence);
+        writer.u64(sequenceLengths.at(sid));
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef SEEDINDEXFILE_H
+#define SEEDINDEXFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tsl/hopscotch_map.h>
+#include "CacheFile.h"
+#include "Configuration.h"
+#include "IdentifierMapping.h"
+#include "KmerOccurrence.h"
+#include "MappedFile.h"
+#include "SeedIndex.h"
+
+//! Persisted SeedIndex of a set of genomes ('--build-seed-index'), memory mapped by query runs ('--seed-index')
+/*! The file holds the masks and seed options, the KmerOccurrence layout, the genome and sequence IDs with the sequence
+ * lengths and the arrays of a sorted SeedIndex. Genome ID 1 is reserved for the query genome ('--genome2'
+ * of the query run), the reference keeps ID 0 as in a regular run, so occurrences are used as stored.
+ *
+ * The file is mapped read-only and shared, i.e. concurrent query runs use the same pages of the page cache
+ * and only the pages touched by lookups are read from disk. */
+class SeedIndexFile {
+public:
+    //! Increment if the file layout changes
+    static constexpr uint64_t formatVersion = 5;
+
+    //! An indexed sequence
+    struct Sequence {
+        size_t gid;
+        std::string header;
+        size_t length;
+    };
+
+    //! c'tor
+    /*! \param path Seed index file to map, throws if it is not a seed index file */
+    SeedIndexFile(fs::path const & path);
+    //! Throw if the seeds of \c config differ from the seeds of the index
+    /*! Compares the masks, '--canonical-seeds', '--minimizer-window', '--redmask', '--reference-sampling' and '--thinning' */
+    void checkCompatible(Configuration const & config) const;
+    //! Register the indexed genomes and sequences with their stored IDs in \c idMap, fill \c sequenceLengths
+    /*! \c idMap must only contain the reference (ID 0) and the query genome (ID 1) */
+    void fillIdentifierMapping(IdentifierMapping & idMap, tsl::hopscotch_map<size_t, size_t> & sequenceLengths) const;
+    //! Getter for member \c layout_
+    auto const & layout() const { return layout_; }
+    //! Getter for member \c path_
+    auto const & path() const { return path_; }
+    //! Return the stored SeedIndex, its arrays are used in place and keep the mapping alive
+    template <typename TwoBitSeedDataType>
+    std::shared_ptr<SeedIndex<TwoBitSeedDataType> const> seedIndex() const {
+        CacheReader reader(file_->data() + indexOffset_, file_->size() - indexOffset_);
+        auto index = std::make_shared<SeedIndex<TwoBitSeedDataType>>();
+        index->read(reader, file_);
+        if (index->numMasks() != masks_.size()) {
+            throw std::runtime_error("[ERROR] -- SeedIndexFile -- Inconsistent number of masks in " + path_.string());
+        }
+        return index;
+    }
+    //! Write \c index of the genomes in \c idMap to \c path
+    /*! The file is written under a temporary name and renamed afterwards, so concurrent runs never see a partial index */
+    template <typename TwoBitSeedDataType>
+    static void write(fs::path const & path,
+                      Configuration const & config,
+                      IdentifierMapping const & idMap,
+                      tsl::hopscotch_map<size_t, size_t> const & sequenceLengths,
+                      SeedIndex<TwoBitSeedDataType> const & index) {
+        auto tmpPath = temporaryPath(path);
+        CacheWriter writer(tmpPath);
+        writeHeader(writer, config, idMap, sequenceLengths);
+        index.write(writer);
+        commit(writer, tmpPath, path);
+    }
+
+private:
+    //! Close \c writer and rename \c tmpPath to \c path, throws and removes \c tmpPath if writing failed
+    static void commit(CacheWriter & writer, fs::path const & tmpPath, fs::path const & path);
+    //! Temporary file name for writing \c path
+    static fs::path temporaryPath(fs::path const & path);
+    //! Write everything except the SeedIndex
+    static void writeHeader(CacheWriter & writer,
+                            Configuration const & config,
+                            IdentifierMapping const & idMap,
+                            tsl::hopscotch_map<size_t, size_t> const & sequenceLengths);
+
+    //! Seeds were stored in canonical form
+    bool canonicalSeeds_;
+    //! Mapped file
+    std::shared_ptr<MappedFile const> file_;
+    //! Genome names in ID order, ID 1 (query genome) is empty
+    std::vector<std::string> genomeNames_;
+    //! Byte offset of the SeedIndex in the file
+    size_t indexOffset_;
+    //! KmerOccurrence layout of the stored occurrences
+    KmerOccurrence::Layout layout_;
+    //! Masks the index was built with
+    std::vector<std::string> masks_;
+    //! Minimizer window the index was built with
+    size_t minimizerWindow_;
+    //! Path of the file
+    fs::path path_;
+    //! '--redmask' the index was built with
+    bool redmask_;
+    //! Reference sampling the index was built with
+    size_t referenceSampling_;
+    //! Indexed sequences in ID order
+    std::vector<Sequence> sequences_;
+    //! Thinning the index was built with
+    size_t thinning_;
+};
+
+#endif // SEEDINDEXFILE_H
@@ -2,10 +2,14 @@
 #define SEEDMAP_H
 
 #include <algorithm>
+#include <array>
 #include <cstdlib>
 #include <execution>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <type_traits>
@@ -19,7 +23,12 @@
 #include "IdentifierMapping.h"
 #include "KmerOccurrence.h"
 #include "ParallelizationUtils.h"
+#include "Prefetch.h"
 #include "ReferenceSeedMap.h"
+#include "SeedCounter.h"
+#include "SeedIndex.h"
+#include "SeedPresenceFilter.h"
+#include "SeedSpill.h"
 #include "SpacedSeedMask.h"
 #include "TwoBitKmer.h"
  
@@ -29,7 +38,11 @@ struct PrefilterSeedMapTag{};
 
 //! Base class for a (spaced) seed map
 /*! Dictates the methods a productive child needs to implement in order to work,
- * implements most methods */
+ * implements most methods
+ *
+ * Seeds are either stored in hash maps (default) or in a sorted SeedIndex ('--sorted-seed-index').
+ * The hash maps are split into shards by the top bits of the seed hash, each shard has its own lock,
+ * so that threads can insert concurrently */
 template <typename TwoBitSeedDataType>
 class SeedMap {
 public:
@@ -45,6 +58,8 @@ public:
                                            std::equal_to<TwoBitKmer<TwoBitSeedDataType>>,
                                            std::allocator<std::pair<TwoBitKmer<TwoBitSeedDataType>, std::vector<std::vector<KmerOccurrence>>>>,
                                            62, false, tsl::hh::mod_growth_policy<std::ratio<11,10>>>;
+    //! Occurrences of a seed in \c SeedMapType, one vector for each mask
+    using OccurrenceVectors = typename SeedMapType::mapped_type;
 
     //! Sanity check idMap during construction
     void factory() {
@@ -63,8 +78,9 @@ public:
             std::shared_ptr<IdentifierMapping const> idMap)
         : config_{config}, idMap_{idMap},
           maskCollection_{config_->maskCollection()},
-          mutex_{}, rd_{}, referenceSeedMap_{*config},
-          seedMap_{} { factory(); }
+          mutex_{}, numDroppedSeeds_{0}, presenceFilterBytes_{0}, rd_{}, referenceSeedMap_{*config},
+          seedIndex_{}, shardBits_{shardBitsFor(config_->nThreads())},
+          shardMutexes_(size_t{1} << shardBits_), shards_(size_t{1} << shardBits_), slots_{} { factory(); }
     //! c'tor (2)
     /*! \param config Shared main configuration object
      * \param idMap Shared identifier map
@@ -74,42 +90,263 @@ public:
             PrefilterSeedMapTag)
         : config_{config}, idMap_{idMap},
           maskCollection_{config_->preMaskCollection()},
-          mutex_{}, rd_{}, referenceSeedMap_{*config},
-          seedMap_{} { factory(); }
+          mutex_{}, numDroppedSeeds_{0}, presenceFilterBytes_{0}, rd_{}, referenceSeedMap_{*config},
+          seedIndex_{}, shardBits_{shardBitsFor(config_->nThreads())},
+          shardMutexes_(size_t{1} << shardBits_), shards_(size_t{1} << shardBits_), slots_{} { factory(); }
     //! Copy c'tor
-    /*! Does not copy mutexes and rng state */
+    /*! Does not copy mutexes and rng state, the reference slots are collected again for the copied shards */
     SeedMap(SeedMap<TwoBitSeedDataType> const & other)
         : config_{other.config_}, idMap_{other.idMap_},
           maskCollection_{other.maskCollection_},
-          mutex_{}, rd_{}, referenceSeedMap_{other.referenceSeedMap_},
-          seedMap_{other.seedMap_} {}
+          mutex_{}, numDroppedSeeds_{other.numDroppedSeeds_},
+          presenceFilterBytes_{other.presenceFilterBytes_}, rd_{}, referenceSeedMap_{*other.config_},
+          seedIndex_{other.seedIndex_}, shardBits_{other.shardBits_},
+          shardMutexes_(other.shards_.size()), shards_{other.shards_}, slots_{} { collectReferenceSlots(); }
+
+    //! Buffers the seeds of a single thread for each shard and inserts them in batches
+    /*! Only the lock of the shard that is flushed is taken, so inserters of different threads rarely
+     * wait for each other. Call \c flush() when done, remaining seeds are not inserted otherwise.
+     *
+     * The hash of each seed is computed once and buffered with it. A flush works in blocks of
+     * \c prefetchBlockSize seeds: all seeds of a block are probed and the occurrence vectors of the seeds
+     * that are already present are prefetched, then the occurrences are appended */
+    class ShardInserter {
+    public:
+        //! c'tor
+        /*! \param seedMap SeedMap to insert into, must use hash maps */
+        ShardInserter(SeedMap & seedMap)
+            : bufferSize_{std::clamp(bufferBudget_ / std::max<size_t>(seedMap.shards_.size(), 1), prefetchBlockSize, maxBufferSize_)},
+              buffers_(seedMap.shards_.size()), hashes_(seedMap.shards_.size()), seedMap_{seedMap} {}
+        //! Buffer a seed, insert the buffer of its shard if it is full
+        void operator()(TwoBitKmer<TwoBitSeedDataType> const & seed, KmerOccurrence const & occurrence, size_t maskIndex) {
+            auto hash = TwoBitKmerHash<TwoBitSeedDataType>{}(seed);
+            auto shard = seedMap_.shardOfHash(hash);
+            buffers_[shard].emplace_back(seed, occurrence, maskIndex);
+            hashes_[shard].emplace_back(hash);
+            if (buffers_[shard].size() >= bufferSize_) { flushShard(shard); }
+        }
+        //! Insert all buffered seeds
+        void flush() {
+            for (size_t shard = 0; shard < buffers_.size(); ++shard) { flushShard(shard); }
+        }
+
+    private:
+        //! Insert the buffered seeds of \c shard
+        /*! Works in stages over blocks of \c prefetchBlockSize seeds: probe with the buffered hashes and prefetch
+         * the occurrence vectors of the found seeds, then pick the vector of the mask and prefetch its end,
+         * then append. Seeds that are not present yet are inserted after the appends of their block */
+        void flushShard(size_t shard) {
+            auto& records = buffers_[shard];
+            if (records.empty()) { return; }
+            auto& map = seedMap_.shards_[shard];
+            std::array<OccurrenceVectors *, prefetchBlockSize> found{};
+            std::array<std::vector<KmerOccurrence> *, prefetchBlockSize> targets{};
+            std::unique_lock<std::mutex> lock(seedMap_.shardMutexes_[shard]);
+            for (size_t block = 0; block < records.size(); block += prefetchBlockSize) {
+                auto n = std::min(prefetchBlockSize, records.size() - block);
+                for (size_t i = 0; i < n; ++i) {
+                    auto it = map.find(records[block + i].seed, hashes_[shard][block + i]);
+                    found[i] = (it == map.end()) ? nullptr : &it.value();
+                    if (found[i]) { prefetch(found[i]->data()); }
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    targets[i] = found[i] ? &(*found[i])[records[block + i].maskIndex] : nullptr;
+                    if (targets[i]) { prefetch(targets[i]->data() + targets[i]->size()); }
+                }
+                // append to present seeds first, inserting new seeds may rehash and move them
+                for (size_t i = 0; i < n; ++i) {
+                    if (targets[i]) { targets[i]->emplace_back(records[block + i].occurrence); }
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    if (targets[i]) { continue; }
+                    auto& record = records[block + i];
+                    seedMap_.accessSeedInShard(shard, record.seed).at(record.maskIndex).emplace_back(record.occurrence);
+                }
+            }
+            lock.unlock();
+            records.clear();
+            hashes_[shard].clear();
+        }
+
+        //! Number of buffered seeds of all shards together
+        /*! The number of shards grows with the number of threads, so a fixed size per shard would make the
+         * buffers of all threads grow quadratically with the number of threads */
+        static constexpr size_t bufferBudget_ = size_t{1} << 16;
+        //! Maximum number of buffered seeds per shard
+        static constexpr size_t maxBufferSize_ = 1024;
+        //! Number of buffered seeds per shard before they are inserted
+        size_t bufferSize_;
+        //! Seeds waiting for insertion, one buffer per shard
+        std::vector<std::vector<SeedRecord<TwoBitSeedDataType>>> buffers_;
+        //! Hashes of the seeds in \c buffers_
+        std::vector<std::vector<size_t>> hashes_;
+        //! Target SeedMap
+        SeedMap & seedMap_;
+    };
 
     //! Add a new seed to the seed map
     /*! This includes filtering and calling cleanup if neccessary, it is important that the
-     * \c seedMap_ member is in a valid state according to filter criteria after calling \c addSeed() */
+     * \c shards_ member is in a valid state according to filter criteria after calling \c addSeed().
+     * Can be called from multiple threads, use a ShardInserter for many seeds. Call \c collectReferenceSlots()
+     * after all seeds are added */
     void addSeed(TwoBitKmer<TwoBitSeedDataType> const & seed,
                  KmerOccurrence const & occurrence,
                  size_t maskIndex) {
         if (seed.length() != maskCollection_->weight()) { throw std::runtime_error("[ERROR] -- SeedMap::addSeed() -- Wrong seed length"); }
-        accessSeedInMap(seed).at(maskIndex).emplace_back(occurrence);
-        if ((!config_->allvsall()) && occurrence.genome() == 0) { referenceSeedMap_.addSeed(occurrence.sequence(), seed); }
+        if (config_->sortedSeedIndex()) { throw std::runtime_error("[ERROR] -- SeedMap::addSeed() -- Single seeds cannot be added to a sorted seed index"); }
+        auto shard = shardOf(seed);
+        std::unique_lock<std::mutex> shardLock(shardMutexes_[shard]);
+        accessSeedInShard(shard, seed).at(maskIndex).emplace_back(occurrence);
     }
     //! Getter for member config_
     auto config() const { return config_; }
     //! (Fwd) Remove duplicates in referenceSeedMap_ in parallel
     void cleanupReferenceSeeds(bool parallel = true) { referenceSeedMap_.cleanupReferenceSeeds(parallel); }
-    //! Clear the seedMap member that stores the mapping from a seed to its occurrences
-    void clear() { seedMap_.clear(); }
+    //! Clear the seedMap member that stores the mapping from a seed to its occurrences, and the reference slots
+    void clear() {
+        for (auto&& shard : shards_) { shard.clear(); }
+        seedIndex_.clear();
+        referenceSeedMap_.clear();
+        std::vector<OccurrenceVectors const *>().swap(slots_);
+    }
+    //! In 1-vs-all mode, fill \c referenceSeedMap_ with the slots of all seeds that occur in each reference sequence
+    /*! A slot is the index of a seed in \c seedIndex_ or, with hash maps, in \c slots_, which points to the
+     * occurrences of each seed in \c shards_ in the order of iteration. Partitions are scanned in parallel,
+     * each thread adds the slots in ascending order. Slots are invalidated when seeds are added */
+    void collectReferenceSlots(bool parallel = true) {
+        referenceSeedMap_.clear();
+        std::vector<OccurrenceVectors const *>().swap(slots_);
+        if (config_->allvsall()) { return; }
+        std::vector<size_t> slotStarts(numPartitions() + 1, 0);  // first slot of each partition
+        for (size_t p = 0; p < numPartitions(); ++p) {
+            slotStarts[p + 1] = config_->sortedSeedIndex() ? seedIndex_.size() * (p + 1) / numPartitions()
+                                                           : slotStarts[p] + shards_[p].size();
+        }
+        if (!config_->sortedSeedIndex()) { slots_.resize(slotStarts.back()); }
+        std::vector<size_t> partitionIDs(numPartitions());
+        std::iota(partitionIDs.begin(), partitionIDs.end(), 0);
+        auto collect = [this, &slotStarts](std::vector<size_t>::const_iterator it, std::vector<size_t>::const_iterator end) {
+            ReferenceSeedMap referenceSlots{*config_};
+            for (; it != end; ++it) {
+                if (!config_->sortedSeedIndex()) {
+                    auto slot = slotStarts[*it];
+                    for (auto&& elem : shards_[*it]) { slots_[slot++] = &elem.second; }
+                }
+                for (auto slot = slotStarts[*it]; slot < slotStarts[*it + 1]; ++slot) {
+                    auto occurrences = occurrencesOfSlot(slot);
+                    for (size_t maskID = 0; maskID < occurrences.size(); ++maskID) {
+                        for (auto&& occurrence : occurrences.at(maskID)) {
+                            if (occurrence.genome() == 0) { referenceSlots.addSlot(occurrence.sequence(), slot); }
+                        }
+                    }
+                }
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            referenceSeedMap_.merge(referenceSlots);
+        };
+        executeParallel(partitionIDs, parallel ? config_->nThreads() : 1, collect);
+        cleanupReferenceSeeds(parallel);
+    }
     //! Run seed extraction from input fastas
-    void extractSeeds(std::shared_ptr<FastaCollection const> fastaCollection,
+    /*! With '--sorted-seed-index', the seeds are collected in per-thread buffers and sorted into \c seedIndex_,
+     * otherwise each thread inserts its seeds into \c shards_ with a ShardInserter.
+     * With '--presence-filter' and '--count-seeds', additional passes run first (see \c buildPresenceFilter()
+     * and \c countSeeds()), their results decide which seeds are stored */
+    void extractSeeds(std::shared_ptr<FastaCollectionView const> fastaCollection,
                       bool parallel = true) {
-        auto wrapper = [this](TwoBitKmer<TwoBitSeedDataType> seed, KmerOccurrence occ, size_t maskInd) {
-            addSeed(seed, occ, maskInd);
-        };
-
         ExtractSeeds<TwoBitSeedDataType> extractor{maskCollection_, idMap_, config_};
-        extractor.extractFromFastas(fastaCollection, wrapper, parallel);
-        cleanupReferenceSeeds(parallel);
+        std::unique_ptr<SeedPresenceFilter<TwoBitSeedDataType>> presenceFilter;
+        std::unique_ptr<SeedCounter<TwoBitSeedDataType>> counter;
+        auto keep = runFilterPasses(extractor, fastaCollection, parallel, presenceFilter, counter);
+        if (config_->sortedSeedIndex()) {
+            auto buffers = extractor.extractRecordsFromFastas(fastaCollection, parallel, keep);
+            seedIndex_.build(std::move(buffers), maskCollection_->size(), config_->maxPrefixLength(), parallel ? config_->nThreads() : 1,
+                             config_->compressPostings());
+        } else {
+            extractor.extractIntoSinks(fastaCollection, [this]() { return ShardInserter(*this); }, parallel, keep);
+        }
+        collectReferenceSlots(parallel);
+    }
+    //! Run seed extraction from input fastas into the partitions of \c spill instead of this seed map ('--seed-partitions')
+    /*! Filter passes run as in \c extractSeeds(), load the partitions with \c loadPartition() afterwards */
+    void extractSeeds(std::shared_ptr<FastaCollectionView const> fastaCollection,
+                      SeedSpill<TwoBitSeedDataType> & spill,
+                      bool parallel = true) {
+        if (!config_->allvsall()) { throw std::runtime_error("[ERROR] -- SeedMap::extractSeeds() -- Spilled seeds are only supported in all-vs-all mode"); }
+        ExtractSeeds<TwoBitSeedDataType> extractor{maskCollection_, idMap_, config_};
+        std::unique_ptr<SeedPresenceFilter<TwoBitSeedDataType>> presenceFilter;
+        std::unique_ptr<SeedCounter<TwoBitSeedDataType>> counter;
+        auto keep = runFilterPasses(extractor, fastaCollection, parallel, presenceFilter, counter);
+        extractor.extractIntoSinks(fastaCollection,
+                                   [&spill]() { return typename SeedSpill<TwoBitSeedDataType>::Writer(spill); },
+                                   parallel, keep);
+        spill.finish();
+    }
+    //! Replace the seeds of this seed map with the seeds of partition \c p of \c spill
+    /*! Partitions hold all occurrences of their seeds, so links can be created for each partition independently */
+    void loadPartition(SeedSpill<TwoBitSeedDataType> const & spill, size_t p, bool parallel = true) {
+        clear();
+        auto nThreads = parallel ? config_->nThreads() : 1;
+        auto buffers = spill.read(p, nThreads);
+        if (config_->sortedSeedIndex()) {
+            seedIndex_.build(std::move(buffers), maskCollection_->size(), config_->maxPrefixLength(), nThreads, config_->compressPostings());
+        } else {
+            using BufferIterator = typename std::vector<std::vector<SeedRecord<TwoBitSeedDataType>>>::const_iterator;
+            auto insert = [this](BufferIterator it, BufferIterator end) {
+                ShardInserter inserter(*this);
+                for (; it != end; ++it) {
+                    for (auto&& record : *it) { inserter(record.seed, record.occurrence, record.maskIndex); }
+                }
+                inserter.flush();
+            };
+            executeParallel(buffers, nThreads, insert);
+        }
+    }
+    //! Return the occurrences of \c seed for each mask, SeedOccurrences::found() is \c false if the seed is not present
+    SeedOccurrences find(TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        if (config_->sortedSeedIndex()) { return seedIndex_.find(seed); }
+        auto& shard = shards_[shardOf(seed)];
+        auto it = shard.find(seed);
+        return (it == shard.end()) ? SeedOccurrences() : SeedOccurrences(it->second);
+    }
+    //! Return the occurrences of the seed in \c slot, see \c collectReferenceSlots()
+    SeedOccurrences occurrencesOfSlot(uint64_t slot) const {
+        return config_->sortedSeedIndex() ? seedIndex_.row(slot) : SeedOccurrences(*slots_[slot]);
+    }
+    //! Batched \c occurrencesOfSlot(), sets \c occurrences to the occurrences of the slots in [\c first, \c last)
+    /*! Prefetches the occurrence vectors of a block of slots, then the occurrences of each mask */
+    void occurrencesOfSlots(std::vector<uint64_t>::const_iterator first, std::vector<uint64_t>::const_iterator last,
+                            std::vector<SeedOccurrences> & occurrences) const {
+        if (config_->sortedSeedIndex()) {
+            seedIndex_.rows(first, last, occurrences);
+            return;
+        }
+        occurrences.clear();
+        while (first != last) {
+            auto blockEnd = first + static_cast<std::ptrdiff_t>(std::min<size_t>(prefetchBlockSize, static_cast<size_t>(last - first)));
+            for (auto it = first; it != blockEnd; ++it) { prefetch(slots_[*it]->data()); }
+            for (; first != blockEnd; ++first) {
+                prefetchOccurrences(*slots_[*first]);
+                occurrences.emplace_back(*slots_[*first]);
+            }
+        }
+    }
+    //! Call \c function(seed, SeedOccurrences) for each seed, independent of the storage of the seeds
+    template <typename F>
+    void forEachSeed(F function) const {
+        for (size_t p = 0; p < numPartitions(); ++p) { forEachSeedInPartition(p, function); }
+    }
+    //! Call \c function(seed, SeedOccurrences) for each seed in partition \c p
+    /*! Partitions are the shards or equally sized key ranges of the sorted index, different partitions
+     * can be processed in parallel */
+    template <typename F>
+    void forEachSeedInPartition(size_t p, F function) const {
+        if (config_->sortedSeedIndex()) {
+            auto n = seedIndex_.size();
+            seedIndex_.forEachInRange(n * p / numPartitions(), n * (p + 1) / numPartitions(), function);
+        } else {
+            for (auto&& elem : shards_.at(p)) { function(elem.first, SeedOccurrences(elem.second)); }
+        }
     }
     //! Getter for member \c genome0_
     auto const & genome0() const { return config_->genome1(); }
@@ -124,20 +361,28 @@ public:
     //! Merge \c seedMap_ of \c localMap with this
     void merge(std::shared_ptr<SeedMap<TwoBitSeedDataType>> localMap) {
         if (maskCollection_ != localMap->maskCollection_) { throw std::runtime_error("[ERROR] -- SeedMap::merge() -- Merging from different mask collections"); }
-        for (auto&& elem : localMap->seedMap_) {
-            auto& seed = elem.first;
-            for (size_t i = 0; i < maskCollection_->size(); ++i) {
-                auto& localOccurrenceVector = elem.second.at(i);
-                accessSeedInMap(seed).at(i).insert(seedMap_.at(seed).at(i).end(),
+        if (config_->sortedSeedIndex()) { throw std::runtime_error("[ERROR] -- SeedMap::merge() -- Merging not supported with a sorted seed index"); }
+        for (auto&& localShard : localMap->shards_) {
+            for (auto&& elem : localShard) {
+                auto& seed = elem.first;
+                auto shard = shardOf(seed);
+                std::unique_lock<std::mutex> lock(shardMutexes_[shard]);
+                auto& occurrenceVectors = accessSeedInShard(shard, seed);
+                for (size_t i = 0; i < maskCollection_->size(); ++i) {
+                    auto& localOccurrenceVector = elem.second.at(i);
+                    occurrenceVectors.at(i).insert(occurrenceVectors.at(i).end(),
                                                    localOccurrenceVector.begin(), localOccurrenceVector.end());
+                }
             }
         }
-        referenceSeedMap_.merge(localMap->referenceSeedMap());
+        collectReferenceSlots();   // shards may have been rehashed
     }
     //! Forward getter for nThreads() in config
     auto nThreads() const { return config_->nThreads(); }
     //! Forwards to method \c numGenomes of \c idMap_
     auto numGenomes() const { return idMap_->numGenomes(); }
+    //! Number of partitions for \c forEachSeedInPartition()
+    size_t numPartitions() const { return shards_.size(); }
     //! Forwards to method \c numSequences of \c idMap_
     auto numSequences() const { return idMap_->numSequences(); }
     //! Copy assignment
@@ -145,23 +390,48 @@ public:
         config_ = other.config_;
         idMap_ = other.idMap_;
         maskCollection_ = other.maskCollection_;
-        referenceSeedMap_ = other.referenceSeedMap_;
-        seedMap_ = other.seedMap_;
+        seedIndex_ = other.seedIndex_;
+        shardBits_ = other.shardBits_;
+        std::vector<std::mutex>(other.shards_.size()).swap(shardMutexes_);
+        shards_ = other.shards_;
+        numDroppedSeeds_ = other.numDroppedSeeds_;
+        presenceFilterBytes_ = other.presenceFilterBytes_;
+        collectReferenceSlots();
         return *this;
     }
     //! Print statistics about the seed map creation process
     void printStatistics() const {
-        auto numKmers = seedMap_.size();
-        std::cout << "Number of unique k-mers created from the input files: " << numKmers << std::endl;
+        std::cout << "Number of unique k-mers created from the input files: " << size() << std::endl;
+        if (config_->sortedSeedIndex()) {
+            std::cout << "Memory used by the sorted seed index: " << seedIndex_.objectSize() / (1024 * 1024) << " MiB"
+                      << " (prefix length " << seedIndex_.prefixLength() << ")" << std::endl;
+        }
+        if (config_->compressPostings()) {
+            std::cout << "Compressed postings: " << seedIndex_.postings().size() << " seeds (per mask), "
+                      << seedIndex_.postings().objectSize() / (1024 * 1024) << " MiB" << std::endl;
+        }
+        if (config_->countSeeds()) {
+            std::cout << "Seeds (per mask) not stored due to occurrence limits: " << numDroppedSeeds_ << std::endl;
+        }
+        if (config_->presenceFilter()) {
+            std::cout << "Memory used by the seed presence filter: " << presenceFilterBytes_ / (1024 * 1024) << " MiB" << std::endl;
+        }
     }
     //! Getter for member \c referenceSeedMap_
     auto const & referenceSeedMap() const { return referenceSeedMap_; }
+    //! Getter for member \c seedIndex_, empty without '--sorted-seed-index'
+    auto const & seedIndex() const { return seedIndex_; }
     //! Getter for member \c seedSetSize_
     auto seedSetSize() const { return maskCollection_->size(); }
-    //! Getter for member \c seedMap_
-    auto const & seedMap() const { return seedMap_; }
+    //! Getter for member \c shards_, empty with '--sorted-seed-index', see \c forEachSeed() and \c find()
+    auto const & shards() const { return shards_; }
     //! Return number of seeds
-    auto size() const { return seedMap_.size(); }
+    size_t size() const {
+        if (config_->sortedSeedIndex()) { return seedIndex_.size(); }
+        size_t n = 0;
+        for (auto&& shard : shards_) { n += shard.size(); }
+        return n;
+    }
     //! Getter for member spacedSeedMasks_
     auto spacedSeedMasks() const { return maskCollection_; }
     //! Getter for member \c span_
@@ -170,12 +440,104 @@ public:
     auto weight() const { return maskCollection_->weight(); }
 
 protected:
-    //! Returns reference to \c seedMap_[seed], creates correctly sized vectors if new seed
-    auto& accessSeedInMap(TwoBitKmer<TwoBitSeedDataType> const & seed) {
-        if (seedMap_.find(seed) == seedMap_.end()) {
-            seedMap_.emplace(seed, maskCollection_->size());
+    //! Counting pass of '--count-seeds'
+    /*! Counts all seeds that pass \c keep (if set), remembers the seeds that fail the per genome occurrence
+     * limits and reserves \c shards_ for the remaining distinct seeds. Returns the counter to filter the seeds
+     * of the final pass */
+    std::unique_ptr<SeedCounter<TwoBitSeedDataType>> countSeeds(ExtractSeeds<TwoBitSeedDataType> & extractor,
+                                                                std::shared_ptr<FastaCollectionView const> fastaCollection,
+                                                                bool parallel,
+                                                                std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> keep) {
+        auto counter = std::make_unique<SeedCounter<TwoBitSeedDataType>>(maskCollection_->size(), idMap_->numGenomes(), shardBits_);
+        extractor.extractIntoSinks(fastaCollection,
+                                   [&counter]() { return typename SeedCounter<TwoBitSeedDataType>::ShardCounter(*counter); },
+                                   parallel, keep);
+        // in 1-vs-all mode, reference occurrences are split by sequence before the limits are checked
+        counter->finalize(config_->occurrencePerGenomeMax(), config_->occurrencePerGenomeMin(), config_->allvsall(),
+                          parallel ? config_->nThreads() : 1);
+        if (!config_->sortedSeedIndex() && config_->seedPartitions() == 1) {   // spilled seeds are loaded one partition at a time
+            for (size_t shard = 0; shard < shards_.size(); ++shard) { shards_[shard].reserve(counter->numKept(shard)); }
         }
-        return seedMap_[seed];
+        numDroppedSeeds_ = counter->numDropped();
+        return counter;
+    }
+    //! Run the passes of '--presence-filter' and '--count-seeds' (if set), return the predicate that decides which seeds are stored
+    /*! The filters are stored in \c presenceFilter and \c counter, which must outlive the returned predicate */
+    std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> runFilterPasses(ExtractSeeds<TwoBitSeedDataType> & extractor,
+                                                                                         std::shared_ptr<FastaCollectionView const> fastaCollection,
+                                                                                         bool parallel,
+                                                                                         std::unique_ptr<SeedPresenceFilter<TwoBitSeedDataType>> & presenceFilter,
+                                                                                         std::unique_ptr<SeedCounter<TwoBitSeedDataType>> & counter) {
+        std::function<bool(TwoBitKmer<TwoBitSeedDataType> const &, size_t)> keep = nullptr;
+        if (config_->presenceFilter()) {
+            presenceFilter = buildPresenceFilter(extractor, fastaCollection, parallel);
+            keep = [&presenceFilter](TwoBitKmer<TwoBitSeedDataType> const & seed, size_t maskIndex) {
+                return presenceFilter->mayBeShared(seed, maskIndex);
+            };
+        }
+        if (config_->countSeeds()) {
+            counter = countSeeds(extractor, fastaCollection, parallel, keep);
+            keep = [&presenceFilter, &counter](TwoBitKmer<TwoBitSeedDataType> const & seed, size_t maskIndex) {
+                return (!presenceFilter || presenceFilter->mayBeShared(seed, maskIndex)) && !counter->dropped(seed, maskIndex);
+            };
+        }
+        return keep;
+    }
+    //! Filter pass of '--presence-filter'
+    /*! Records which seeds occur in the reference and in any other genome. The filters are sized by an upper
+     * bound for the number of distinct seeds, see \c distinctSeedBound() */
+    std::unique_ptr<SeedPresenceFilter<TwoBitSeedDataType>> buildPresenceFilter(ExtractSeeds<TwoBitSeedDataType> & extractor,
+                                                                               std::shared_ptr<FastaCollectionView const> fastaCollection,
+                                                                               bool parallel) {
+        size_t referenceLength = 0;
+        size_t otherLength = 0;
+        for (auto&& elem : fastaCollection->collection()) {
+            for (auto&& sequence : elem.second) {
+                auto& length = (idMap_->queryGenomeIDConst(sequence->genomeName()) == 0) ? referenceLength : otherLength;
+                length += sequence->sequence().size();
+            }
+        }
+        auto filter = std::make_unique<SeedPresenceFilter<TwoBitSeedDataType>>(distinctSeedBound(referenceLength),
+                                                                               distinctSeedBound(otherLength));
+        extractor.extractIntoSinks(fastaCollection,
+                                   [&filter]() { return typename SeedPresenceFilter<TwoBitSeedDataType>::Inserter(*filter); },
+                                   parallel);
+        presenceFilterBytes_ = filter->objectSize();
+        return filter;
+    }
+    //! Upper bound for the number of distinct seeds from \c nPositions positions, i.e. min(nPositions, 4^weight) per mask
+    /*! Saturates instead of overflowing for large weights or many masks */
+    size_t distinctSeedBound(size_t nPositions) const {
+        auto weight = maskCollection_->weight();
+        auto perMask = (2 * weight >= 64) ? nPositions : std::min(nPositions, size_t{1} << (2 * weight));
+        auto nMasks = std::max<size_t>(maskCollection_->size(), 1);
+        return (perMask > std::numeric_limits<size_t>::max() / nMasks) ? std::numeric_limits<size_t>::max()
+                                                                        : perMask * nMasks;
+    }
+    //! Returns reference to \c shards_[shard][seed], creates correctly sized vectors if new seed
+    /*! The caller must hold the lock of \c shard */
+    auto& accessSeedInShard(size_t shard, TwoBitKmer<TwoBitSeedDataType> const & seed) {
+        auto& occurrenceVectors = shards_[shard][seed];
+        if (occurrenceVectors.empty()) { occurrenceVectors.resize(maskCollection_->size()); }
+        return occurrenceVectors;
+    }
+    //! Prefetch the first occurrences of each mask in \c occurrenceVectors
+    static void prefetchOccurrences(OccurrenceVectors const & occurrenceVectors) {
+        for (auto&& occurrenceVector : occurrenceVectors) {
+            if (occurrenceVector.size()) { prefetch(occurrenceVector.data()); }
+        }
+    }
+    //! Shard of \c seed, i.e. the top \c shardBits_ bits of its hash
+    size_t shardOf(TwoBitKmer<TwoBitSeedDataType> const & seed) const { return shardOfHash(TwoBitKmerHash<TwoBitSeedDataType>{}(seed)); }
+    //! Shard of a seed with hash \c hash
+    size_t shardOfHash(size_t hash) const {
+        return (shardBits_ == 0) ? 0 : (static_cast<uint64_t>(hash) >> (64 - shardBits_));
+    }
+    //! Number of shard bits, such that there are about four shards per thread
+    static size_t shardBitsFor(size_t nThreads) {
+        size_t bits = 0;
+        while (bits < 10 && (size_t{1} << bits) < 4 * nThreads) { ++bits; }
+        return bits;
     }
 
     //! Main configuration
@@ -186,12 +548,24 @@ protected:
     std::shared_ptr<SpacedSeedMaskCollection const> maskCollection_;
     //! General lock
     std::mutex mutex_;
+    //! Number of pairs of seed and mask that were not stored due to '--count-seeds'
+    size_t numDroppedSeeds_;
+    //! Size of the filters of '--presence-filter'
+    size_t presenceFilterBytes_;
     //! Used to obtain seed for random link selection if there are too many possibilities
     std::random_device rd_;
-    //! Stores seeds occurring in each reference sequence
-    ReferenceSeedMap<TwoBitSeedDataType> referenceSeedMap_;
-    //! seedMap
-    SeedMapType seedMap_;
+    //! Stores the slots of the seeds occurring in each reference sequence
+    ReferenceSeedMap referenceSeedMap_;
+    //! Seeds and occurrences if '--sorted-seed-index' is set
+    SeedIndex<TwoBitSeedDataType> seedIndex_;
+    //! Number of hash bits that select a shard
+    size_t shardBits_;
+    //! One lock for each shard
+    std::vector<std::mutex> shardMutexes_;
+    //! Seeds and occurrences if '--sorted-seed-index' is not set, split by seed hash
+    std::vector<SeedMapType> shards_;
+    //! Occurrences of each seed in \c shards_ in 1-vs-all mode, indexed by slot, see \c collectReferenceSlots()
+    std::vector<OccurrenceVectors const *> slots_;
 };
 
 #endif // SEEDMAP_H
@@ -0,0 +1,128 @@
+#ifndef SEEDPRESENCEFILTER_H
+#define SEEDPRESENCEFILTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "KmerOccurrence.h"
+#include "TwoBitKmer.h"
+
+
+
+//! Thread-safe Bloom filter of 64 bit hash values, blocked to a single word per value
+/*! All bits of a value are set in the same 64 bit word, so an insertion or query touches a single
+ * cache line. Insertions use atomic \c fetch_or, queries may run concurrently with insertions */
+class BlockedBloomFilter {
+public:
+    //! c'tor
+    /*! \param nElements Expected (maximum) number of inserted values
+     * \param bitsPerElement Filter bits per expected value, the filter is rounded up to a power of two words */
+    BlockedBloomFilter(size_t nElements, size_t bitsPerElement)
+        : nWordBits_{wordBitsFor((nElements > std::numeric_limits<size_t>::max() / std::max<size_t>(bitsPerElement, 1))
+                                     ? std::numeric_limits<size_t>::max() : nElements * bitsPerElement)},
+          words_{std::make_unique<std::atomic<uint64_t>[]>(size_t{1} << nWordBits_)} {
+        for (size_t i = 0; i < size(); ++i) { words_[i].store(0, std::memory_order_relaxed); }
+    }
+    //! Insert a (well mixed) hash value
+    void insert(uint64_t hash) {
+        words_[word(hash)].fetch_or(pattern(hash), std::memory_order_relaxed);
+    }
+    //! Check if a hash value may have been inserted, \c false means it definitely was not
+    bool mayContain(uint64_t hash) const {
+        auto p = pattern(hash);
+        return (words_[word(hash)].load(std::memory_order_relaxed) & p) == p;
+    }
+    //! Memory consumption of the filter in bytes
+    size_t objectSize() const { return sizeof(*this) + size() * sizeof(uint64_t); }
+    //! Number of words
+    size_t size() const { return size_t{1} << nWordBits_; }
+
+private:
+    //! Word of \c hash, taken from its top bits
+    size_t word(uint64_t hash) const { return (nWordBits_ == 0) ? 0 : static_cast<size_t>(hash >> (64 - nWordBits_)); }
+    //! Bits of \c hash in its word, \c nHashes_ positions from the low 6 bit groups of \c hash
+    static uint64_t pattern(uint64_t hash) {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < nHashes_; ++i) { bits |= uint64_t{1} << ((hash >> (6 * i)) & 63); }
+        return bits;
+    }
+    //! Number of word index bits such that the filter has at least \c nBits bits
+    static size_t wordBitsFor(size_t nBits) {
+        size_t bits = 0;
+        while (bits < 58 && (size_t{64} << bits) < nBits) { ++bits; }
+        return bits;
+    }
+
+    //! Number of bits set per value
+    static constexpr size_t nHashes_ = 4;
+    //! Number of hash bits that select a word
+    size_t nWordBits_;
+    //! Filter bits
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+
+
+//! Records which seeds occur in the reference genome and which occur in any other genome ('--presence-filter')
+/*! Linkset::processOccurrences() discards seeds that do not occur in both the reference and another genome.
+ * A first pass over the input fills one Bloom filter for reference seeds and one for the seeds of all other
+ * genomes, a seed that is missing from either filter is not stored in the SeedMap. False positives only
+ * keep a few superfluous seeds, results are not changed */
+template <typename TwoBitSeedDataType>
+class SeedPresenceFilter {
+public:
+    //! c'tor
+    /*! \param nReferenceSeeds Upper bound for the number of distinct (seed, mask) pairs in the reference genome
+     * \param nOtherSeeds Upper bound for the number of distinct (seed, mask) pairs in all other genomes */
+    SeedPresenceFilter(size_t nReferenceSeeds, size_t nOtherSeeds)
+        : other_{nOtherSeeds, bitsPerElement_}, reference_{nReferenceSeeds, bitsPerElement_} {}
+
+    //! Sink for ExtractSeeds::extractIntoSinks(), inserts into the filters directly
+    class Inserter {
+    public:
+        //! c'tor
+        /*! \param filter SeedPresenceFilter to insert into */
+        Inserter(SeedPresenceFilter & filter) : filter_{filter} {}
+        //! Record the occurrence of a seed
+        void operator()(TwoBitKmer<TwoBitSeedDataType> const & seed, KmerOccurrence const & occurrence, size_t maskIndex) {
+            auto h = SeedPresenceFilter::hash(seed, maskIndex);
+            if (occurrence.genome() == 0) { filter_.reference_.insert(h); } else { filter_.other_.insert(h); }
+        }
+        //! Nothing is buffered
+        void flush() {}
+
+    private:
+        //! Target filter
+        SeedPresenceFilter & filter_;
+    };
+
+    //! Check if the seed of mask \c maskIndex may occur both in the reference and in another genome
+    bool mayBeShared(TwoBitKmer<TwoBitSeedDataType> const & seed, size_t maskIndex) const {
+        auto h = hash(seed, maskIndex);
+        return reference_.mayContain(h) && other_.mayContain(h);
+    }
+    //! Memory consumption of the filters in bytes
+    size_t objectSize() const { return reference_.objectSize() + other_.objectSize(); }
+
+private:
+    //! Mixed hash of a seed and its mask, independent of the bits that select a SeedMap shard
+    static uint64_t hash(TwoBitKmer<TwoBitSeedDataType> const & seed, size_t maskIndex) {
+        uint64_t z = static_cast<uint64_t>(TwoBitKmerHash<TwoBitSeedDataType>{}(seed)) + (maskIndex + 1) * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    //! Filter bits per expected seed, about 2% false positives
+    static constexpr size_t bitsPerElement_ = 12;
+    //! Seeds of all genomes except the reference
+    BlockedBloomFilter other_;
+    //! Seeds of the reference genome
+    BlockedBloomFilter reference_;
+};
+
+#endif // SEEDPRESENCEFILTER_H
@@ -0,0 +1,188 @@
+#ifndef SEEDSPILL_H
+#define SEEDSPILL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "KmerOccurrence.h"
+#include "SeedIndex.h"
+#include "TwoBitKmer.h"
+
+namespace fs = std::filesystem;
+
+
+
+//! On-disk partitions of seed records for out-of-core seed map construction ('--seed-partitions')
+/*! Seed extraction writes each record (seed, occurrence, mask) into one of \c nPartitions files, chosen by
+ * the seed hash, so all occurrences of a seed are in the same partition. The partitions are then loaded
+ * one at a time, so only the records of a single partition are held in memory.
+ * A record is stored as the packed bases of the seed, the occurrence and the mask index, 64 bits each.
+ * All partition files are open during extraction, so their number is limited by the open file limit.
+ * Each Writer buffers at most \c writerBudgetWords_ words over all partitions.
+ * The files are removed when the object is destroyed */
+template <typename TwoBitSeedDataType>
+class SeedSpill {
+public:
+    using Record = SeedRecord<TwoBitSeedDataType>;
+
+    //! c'tor
+    /*! \param nPartitions Number of partitions
+     * \param seedLength Length of all seeds
+     * \param directory Directory for the partition files */
+    SeedSpill(size_t nPartitions, size_t seedLength, fs::path const & directory)
+        : counts_(nPartitions, 0), mutexes_(nPartitions), paths_{}, seedWords_{(seedLength + 31) / 32},
+          seedLength_{seedLength}, streams_(nPartitions) {
+        struct rlimit limit{};
+        if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY
+                && nPartitions + reservedFiles_ > limit.rlim_cur) {
+            throw std::runtime_error("[ERROR] -- SeedSpill -- " + std::to_string(nPartitions) + " partitions exceed the open file limit of "
+                                     + std::to_string(limit.rlim_cur) + " (at most " + std::to_string(limit.rlim_cur - std::min<rlim_t>(limit.rlim_cur, reservedFiles_))
+                                     + " partitions), reduce '--seed-partitions' or raise the limit (ulimit -n)");
+        }
+        for (size_t p = 0; p < nPartitions; ++p) {
+            paths_.emplace_back(directory / ("seedPartition." + std::to_string(::getpid()) + "." + std::to_string(p)));
+            streams_[p].open(paths_.back(), std::ios::binary | std::ios::trunc);
+            if (!streams_[p].good()) {
+                removeFiles();
+                throw std::runtime_error("[ERROR] -- SeedSpill -- Cannot write to " + paths_.back().string());
+            }
+        }
+    }
+    SeedSpill(SeedSpill const &) = delete;
+    SeedSpill & operator=(SeedSpill const &) = delete;
+    //! d'tor, removes the partition files
+    ~SeedSpill() { removeFiles(); }
+
+    //! Sink for ExtractSeeds::extractIntoSinks(), buffers the records of a single thread for each partition
+    /*! Only the lock of the partition that is written is taken. Call \c flush() when done */
+    class Writer {
+    public:
+        //! c'tor
+        /*! \param spill SeedSpill to write to */
+        Writer(SeedSpill & spill)
+            : buffers_(spill.numPartitions()),
+              bufferWords_{std::clamp(writerBudgetWords_ / spill.numPartitions(), spill.recordWords(), maxBufferWords_)},
+              spill_{spill} {}
+        //! Buffer a record, write the buffer of its partition if it is full
+        void operator()(TwoBitKmer<TwoBitSeedDataType> const & seed, KmerOccurrence const & occurrence, size_t maskIndex) {
+            auto p = spill_.partitionOf(seed);
+            auto& buffer = buffers_[p];
+            for (size_t i = 0; i < spill_.seedWords_; ++i) { buffer.emplace_back(seed.bases(i)); }
+            buffer.emplace_back(occurrence.data().to_ullong());
+            buffer.emplace_back(maskIndex);
+            if (buffer.size() >= bufferWords_) { flushPartition(p); }
+        }
+        //! Write all buffered records
+        void flush() {
+            for (size_t p = 0; p < buffers_.size(); ++p) { flushPartition(p); }
+        }
+
+    private:
+        //! Write the buffered records of partition \c p
+        void flushPartition(size_t p) {
+            if (buffers_[p].empty()) { return; }
+            std::unique_lock<std::mutex> lock(spill_.mutexes_[p]);
+            spill_.streams_[p].write(reinterpret_cast<char const *>(buffers_[p].data()),
+                                     static_cast<std::streamsize>(buffers_[p].size() * sizeof(uint64_t)));
+            spill_.counts_[p] += buffers_[p].size() / spill_.recordWords();
+            lock.unlock();
+            buffers_[p].clear();
+        }
+
+        //! Upper bound of \c bufferWords_
+        static constexpr size_t maxBufferWords_ = 4096;
+        //! Records waiting to be written, one buffer per partition
+        std::vector<std::vector<uint64_t>> buffers_;
+        //! Number of buffered words per partition before they are written, such that all buffers fit \c writerBudgetWords_
+        size_t bufferWords_;
+        //! Target SeedSpill
+        SeedSpill & spill_;
+    };
+
+    //! Close all partition files after extraction, throws if any write failed
+    void finish() {
+        for (size_t p = 0; p < streams_.size(); ++p) {
+            auto success = streams_[p].good();
+            streams_[p].close();
+            if (!success) { throw std::runtime_error("[ERROR] -- SeedSpill -- Failed to write " + paths_[p].string()); }
+        }
+    }
+    //! Number of partitions
+    size_t numPartitions() const { return paths_.size(); }
+    //! Number of records in partition \c p
+    size_t numRecords(size_t p) const { return counts_.at(p); }
+    //! Number of records in all partitions
+    size_t numRecords() const {
+        size_t n = 0;
+        for (auto count : counts_) { n += count; }
+        return n;
+    }
+    //! Partition of \c seed
+    size_t partitionOf(TwoBitKmer<TwoBitSeedDataType> const & seed) const {
+        return static_cast<size_t>(static_cast<uint64_t>(TwoBitKmerHash<TwoBitSeedDataType>{}(seed)) % paths_.size());
+    }
+    //! Read the records of partition \c p, distributed over \c nBuffers buffers (e.g. one per thread)
+    /*! Call \c finish() first */
+    std::vector<std::vector<Record>> read(size_t p, size_t nBuffers) const {
+        nBuffers = std::max<size_t>(nBuffers, 1);
+        std::vector<std::vector<Record>> buffers(nBuffers);
+        auto n = counts_.at(p);
+        for (size_t b = 0; b < nBuffers; ++b) { buffers[b].reserve(n / nBuffers + 1); }
+        std::ifstream is(paths_.at(p), std::ios::binary);
+        std::vector<uint64_t> chunk(recordWords() * chunkRecords_);
+        for (size_t r = 0; r < n;) {
+            auto m = std::min(chunkRecords_, n - r);
+            is.read(reinterpret_cast<char *>(chunk.data()), static_cast<std::streamsize>(m * recordWords() * sizeof(uint64_t)));
+            if (!is.good()) { throw std::runtime_error("[ERROR] -- SeedSpill -- Failed to read " + paths_.at(p).string()); }
+            for (size_t i = 0; i < m; ++i, ++r) {
+                auto words = chunk.data() + i * recordWords();
+                buffers[r % nBuffers].emplace_back(TwoBitKmer<TwoBitSeedDataType>(words, seedLength_),
+                                                   KmerOccurrence::fromBits(words[seedWords_]),
+                                                   static_cast<size_t>(words[seedWords_ + 1]));
+            }
+        }
+        return buffers;
+    }
+
+private:
+    //! Number of 64 bit words per record
+    size_t recordWords() const { return seedWords_ + 2; }
+    //! Remove all partition files
+    void removeFiles() {
+        for (size_t p = 0; p < paths_.size(); ++p) {
+            if (streams_[p].is_open()) { streams_[p].close(); }
+            std::error_code ec;
+            fs::remove(paths_[p], ec);
+        }
+    }
+
+    //! Number of records that are read at once
+    static constexpr size_t chunkRecords_ = 65536;
+    //! File descriptors left for the input and output files
+    static constexpr size_t reservedFiles_ = 64;
+    //! Number of words that a single Writer buffers over all partitions (8 MiB)
+    static constexpr size_t writerBudgetWords_ = size_t{1} << 20;
+    //! Number of records in each partition
+    std::vector<size_t> counts_;
+    //! One lock for each partition
+    std::vector<std::mutex> mutexes_;
+    //! Partition files
+    std::vector<fs::path> paths_;
+    //! Number of 64 bit words per seed
+    size_t seedWords_;
+    //! Length of all seeds
+    size_t seedLength_;
+    //! Output streams during extraction
+    std::vector<std::ofstream> streams_;
+};
+
+#endif // SEEDSPILL_H
@@ -0,0 +1,117 @@
+#include "SpacedSeedGather.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPACEDSEEDGATHER_X86
+#endif
+
+
+
+SpacedSeedGather::Kernel SpacedSeedGather::bestKernel() {
+    static Kernel const kernel = [](){
+#ifdef SPACEDSEEDGATHER_X86
+        __builtin_cpu_init();
+        auto slowPEXT = __builtin_cpu_is("znver1") || __builtin_cpu_is("znver2");
+        if (kernelSupported(Kernel::bmi2) && !slowPEXT) { return Kernel::bmi2; }
+        if (kernelSupported(Kernel::avx2)) { return Kernel::avx2; }
+#endif
+        return Kernel::scalar;
+    }();
+    return kernel;
+}
+
+
+
+bool SpacedSeedGather::kernelSupported(Kernel kernel) {
+    switch (kernel) {
+#ifdef SPACEDSEEDGATHER_X86
+        case Kernel::avx2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+        case Kernel::bmi2: __builtin_cpu_init(); return __builtin_cpu_supports("bmi2");
+#else
+        case Kernel::avx2: return false;
+        case Kernel::bmi2: return false;
+#endif
+        default: return true;
+    }
+}
+
+
+
+char const * SpacedSeedGather::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::avx2: return "avx2";
+        case Kernel::bmi2: return "bmi2";
+        default: return "scalar";
+    }
+}
+
+
+
+void SpacedSeedGather::gatherBlock(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds,
+                                   Kernel kernel) const {
+    if (!blockCompatible()) { throw std::runtime_error("[ERROR] -- SpacedSeedGather::gatherBlock -- Mask span or weight too big"); }
+    switch (kernel) {
+        case Kernel::avx2: gatherBlockAVX2(lo, hi, n, seeds); break;
+        case Kernel::bmi2: gatherBlockPEXT(lo, hi, n, seeds); break;
+        default: gatherBlockPieces(lo, hi, n, seeds);
+    }
+}
+
+
+
+void SpacedSeedGather::gatherBlockPieces(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const {
+    for (size_t j = 0; j < n; ++j) {
+        uint64_t window[2] = {lo[j], (span_ > 32) ? hi[j] : 0};
+        uint64_t seed = 0;
+        for (auto&& piece : blockPieces_) {
+            seed |= ((window[piece.sourceWord] >> piece.sourceShift) & piece.mask) << piece.targetShift;
+        }
+        seeds[j] = seed;
+    }
+}
+
+
+
+#ifdef SPACEDSEEDGATHER_X86
+__attribute__((target("avx2")))
+void SpacedSeedGather::gatherBlockAVX2(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const {
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        // four windows at once, each piece is a shift, and, shift, or on all lanes
+        __m256i window[2] = {_mm256_loadu_si256(reinterpret_cast<__m256i const *>(lo + j)),
+                             (span_ > 32) ? _mm256_loadu_si256(reinterpret_cast<__m256i const *>(hi + j)) : _mm256_setzero_si256()};
+        auto seed = _mm256_setzero_si256();
+        for (auto&& piece : blockPieces_) {
+            auto value = _mm256_srl_epi64(window[piece.sourceWord], _mm_cvtsi64_si128(static_cast<long long>(piece.sourceShift)));
+            value = _mm256_and_si256(value, _mm256_set1_epi64x(static_cast<long long>(piece.mask)));
+            seed = _mm256_or_si256(seed, _mm256_sll_epi64(value, _mm_cvtsi64_si128(static_cast<long long>(piece.targetShift))));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(seeds + j), seed);
+    }
+    gatherBlockPieces(lo + j, hi + j, n - j, seeds + j);
+}
+
+
+
+__attribute__((target("bmi2")))
+void SpacedSeedGather::gatherBlockPEXT(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const {
+    if (span_ <= 32) {
+        for (size_t j = 0; j < n; ++j) { seeds[j] = _pext_u64(lo[j], pextMask_[0]); }
+    } else {
+        auto loBits = static_cast<unsigned>(__builtin_popcountll(pextMask_[0]));
+        for (size_t j = 0; j < n; ++j) {
+            seeds[j] = _pext_u64(lo[j], pextMask_[0]) | (_pext_u64(hi[j], pextMask_[1]) << loBits);
+        }
+    }
+}
+#else
+void SpacedSeedGather::gatherBlockAVX2(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const {
+    gatherBlockPieces(lo, hi, n, seeds);
+}
+
+
+
+void SpacedSeedGather::gatherBlockPEXT(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const {
+    gatherBlockPieces(lo, hi, n, seeds);
+}
+#endif
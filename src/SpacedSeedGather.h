@@ -0,0 +1,140 @@
+#ifndef SPACEDSEEDGATHER_H
+#define SPACEDSEEDGATHER_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SpacedSeedMask.h"
+
+//! Precomputed extraction of a spaced seed from a packed two bit window
+/*! The set positions of a SpacedSeedMask are compiled into pieces of adjacent positions. Each piece
+ * is copied from the window (see RollingKmerWindow) into the seed with one shift and mask, so the
+ * seed is created in the packed representation of TwoBitKmer without decoding any bases.
+ *
+ * For masks with span <= 64 and weight <= 32, \c gatherBlock() creates the seeds of many windows at
+ * once. It uses BMI2 PEXT or AVX2 if the CPU supports it, see \c bestKernel() */
+class SpacedSeedGather {
+public:
+    //! Implementations of \c gatherBlock()
+    enum class Kernel { scalar, avx2, bmi2 };
+
+    //! c'tor
+    /*! \param mask Spaced seed mask to compile */
+    SpacedSeedGather(SpacedSeedMask const & mask)
+        : blockPieces_{}, pextMask_{0, 0}, pieces_{}, span_{mask.span()}, weight_{mask.weight()} {
+        auto positions = mask.getSetPositions();
+        for (size_t i = 0; i < positions.size();) {
+            // extend piece as long as source positions are adjacent and destination stays in one word
+            size_t length = 1;
+            while (i + length < positions.size()
+                    && positions[i + length] == positions[i] + length
+                    && (i + length) % 32 != 0) {
+                ++length;
+            }
+            pieces_.emplace_back(Piece{2 * positions[i], i / 32, 2 * (i % 32),
+                                       (length == 32) ? ~uint64_t{0} : ((uint64_t{1} << (2 * length)) - 1)});
+            i += length;
+        }
+        if (blockCompatible()) {
+            // pieces for gatherBlock() must not cross the boundary between the two window words
+            for (size_t i = 0; i < positions.size(); ++i) {
+                pextMask_[positions[i] / 32] |= uint64_t{3} << (2 * (positions[i] % 32));
+                if (i > 0 && positions[i] == positions[i - 1] + 1 && positions[i] % 32 != 0) {
+                    blockPieces_.back().mask = (blockPieces_.back().mask << 2) | 3;
+                } else {
+                    blockPieces_.emplace_back(BlockPiece{positions[i] / 32, 2 * (positions[i] % 32), 2 * i, 3});
+                }
+            }
+        }
+    }
+    //! Return the fastest kernel that is supported by this CPU
+    /*! PEXT is preferred unless the CPU implements it in microcode (AMD before Zen 3) */
+    static Kernel bestKernel();
+    //! Return true if this CPU can run \c kernel
+    static bool kernelSupported(Kernel kernel);
+    //! Return a printable name of \c kernel
+    static char const * kernelName(Kernel kernel);
+    //! Getter for member \c span_
+    size_t span() const { return span_; }
+    //! Return true if \c gatherBlock() can be used with this mask, i.e. span <= 64 and weight <= 32
+    bool blockCompatible() const { return span_ <= 64 && weight_ <= 32; }
+    //! Write the seeds of \c n windows to \c seeds, window \c j consists of the words \c lo[j] and \c hi[j]
+    /*! \c hi is only read for spans > 32. Requires \c blockCompatible() and a supported \c kernel */
+    void gatherBlock(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds,
+                     Kernel kernel = bestKernel()) const;
+    //! Write the seed from \c window to \c seed, which must hold \c wordCount() words
+    void gather(std::vector<uint64_t> const & window, uint64_t * seed) const {
+        for (size_t i = 0; i < wordCount(); ++i) { seed[i] = 0; }
+        for (auto&& piece : pieces_) {
+            auto word = piece.sourceBit / 64;
+            auto shift = piece.sourceBit % 64;
+            auto value = window[word] >> shift;
+            if (shift && word + 1 < window.size()) { value |= window[word + 1] << (64 - shift); }
+            seed[piece.targetWord] |= (value & piece.mask) << piece.targetShift;
+        }
+    }
+    //! Return true if the seed in \c seed consists of at most two different bases
+    bool lowComplexity(uint64_t const * seed) const {
+        static constexpr uint64_t lowBits = 0x5555555555555555ULL;
+        unsigned present = 0;
+        for (size_t i = 0; i < wordCount(); ++i) {
+            auto fields = std::min<size_t>(weight_ - 32 * i, 32);
+            auto valid = (fields == 32) ? lowBits : (((uint64_t{1} << (2 * fields)) - 1) & lowBits);
+            for (uint64_t code = 0; code < 4; ++code) {
+                auto x = seed[i] ^ (code * lowBits);    // fields equal to code become 00
+                if (~(x | (x >> 1)) & valid) { present |= (1u << code); }
+            }
+        }
+        return __builtin_popcount(present) <= 2;
+    }
+    //! Getter for member \c weight_
+    auto weight() const { return weight_; }
+    //! Number of words of a seed
+    size_t wordCount() const { return (weight_ + 31) / 32; }
+
+private:
+    //! Adjacent set positions of the mask within one window word, for \c gatherBlock()
+    struct BlockPiece {
+        //! Window word (0 - \c lo, 1 - \c hi)
+        size_t sourceWord;
+        //! First bit in the window word
+        size_t sourceShift;
+        //! First bit in the seed
+        size_t targetShift;
+        //! Bits of the piece after shifting it to bit 0
+        uint64_t mask;
+    };
+    //! Adjacent set positions of the mask
+    struct Piece {
+        //! First bit in the window
+        size_t sourceBit;
+        //! Word in the seed
+        size_t targetWord;
+        //! First bit in the target word
+        size_t targetShift;
+        //! Bits of the piece after shifting it to bit 0
+        uint64_t mask;
+    };
+
+    //! Scalar and AVX2 gatherBlock() kernels
+    void gatherBlockPieces(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const;
+    void gatherBlockAVX2(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const;
+    //! BMI2 gatherBlock() kernel
+    void gatherBlockPEXT(uint64_t const * lo, uint64_t const * hi, size_t n, uint64_t * seeds) const;
+
+    //! Compiled mask for \c gatherBlock()
+    std::vector<BlockPiece> blockPieces_;
+    //! Set positions of the mask in the two window words, for the PEXT kernel
+    std::array<uint64_t, 2> pextMask_;
+    //! Compiled mask
+    std::vector<Piece> pieces_;
+    //! Number of positions in the mask
+    size_t span_;
+    //! Number of bases in a seed
+    size_t weight_;
+};
+
+#endif // SPACEDSEEDGATHER_H
@@ -2,9 +2,11 @@
 #define TWOBITKMER_H
 
 #include <algorithm>
+#include <array>
 #include <bitset>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <functional> // std::hash
 #include <iostream>
 #include <stdexcept>
@@ -44,6 +46,8 @@ struct TwoBitKmerHash;  // fwd declare
  * * bool operator==(TwoBitKmerData const & rhs) const
  * * size_t objectSize() const
  * * size_t size() const
+ * * uint64_t word(size_t i) const // packed word \c i, used for hashing and ordering
+ * * size_t wordCount() const
  *
  * (*)explanation: http://www.catb.org/esr/structure-packing/ */
 template<typename TwoBitKmerData>
@@ -55,6 +59,15 @@ public:
             setBase(bitset_.bitset(position), position, kmer[position]);
         }
     }
+    //! Create a k-mer of length \c length from packed bases
+    /*! \c words holds base \c i in bits 2*(i%32) of word i/32 (see TwoBitSequence),
+     * bits behind the last base must be zero */
+    TwoBitKmer(uint64_t const * words, size_t length)
+        : bitset_{length} {
+        for (size_t i = 0; i < bitset_.wordCount() && 32 * i < length; ++i) {   // constant trip count except for TwoBitKmerDataLong
+            bitset_.bitset(32 * i) |= std::bitset<64>{words[i]};
+        }
+    }
     TwoBitKmer(std::string const & kmer, std::shared_ptr<bool> const & validFlag)
         : bitset_{kmer.size()} {
         for (size_t position = 0; position < kmer.size(); ++position) {
@@ -72,6 +85,10 @@ public:
     char base(size_t position) const {
         return getBase(bitset_.bitsetRO(position), position);
     }
+    //! Return packed word \c i without size information, i.e. bases [32*i, 32*i+32) with base 32*i in the lowest bits
+    uint64_t bases(size_t i) const { return packedWord(i); }
+    //! Number of packed words that hold bases
+    size_t basesWordCount() const { return (length() + 31) / 32; }
     //! Return the length k of the k-mer
     size_t length() const {
         return bitset_.size();
@@ -85,12 +102,37 @@ public:
     //! Compare for equality with a \c std::string
     bool operator==(std::string const & rhs) const { return toString() == rhs; }
     //! Check if this is less than another TwoBitKmer instance
+    /*! Orders by length, then by the packed integer value (highest word first). This is a strict total
+     * order, but not the lexicographic order of the k-mer strings */
     bool operator<(TwoBitKmer const & rhs) const {
-        return toString() < rhs.toString();
+        if (length() != rhs.length()) { return length() < rhs.length(); }
+        for (auto i = bitset_.wordCount(); i > 0; --i) {
+            auto lhsWord = bitset_.word(i - 1);
+            auto rhsWord = rhs.bitset_.word(i - 1);
+            if (lhsWord != rhsWord) { return lhsWord < rhsWord; }
+        }
+        return false;
     }
     //! Create TwoBitKmer of \c this reverse complement
+    /*! Works on the packed words: the two bit fields are reversed, complemented (A <-> T and C <-> G
+     * flip the upper bit) and shifted back to base 0 */
     TwoBitKmer reverseComplement() const {
-        return TwoBitKmer( ::reverseComplement(toString()) );
+        auto k = length();
+        auto n = bitset_.wordCount();
+        std::vector<uint64_t> words(2 * n + 1, 0);   // zero padding for the shift below
+        for (size_t i = 0; i < n; ++i) { words[i] = reverseTwoBitFields(packedWord(n - 1 - i)); }
+        // base i is now at field 32*n - 1 - i, move it to field k - 1 - i
+        auto wordShift = (32 * n - k) / 32;
+        auto bitShift = 2 * ((32 * n - k) % 32);
+        for (size_t i = 0; i < n; ++i) {
+            words[i] = (words[i + wordShift] >> bitShift)
+                       | ((bitShift > 0) ? (words[i + wordShift + 1] << (64 - bitShift)) : 0);
+        }
+        for (size_t i = 0; i < (k + 31) / 32; ++i) {
+            auto bases = std::min<size_t>(32, k - 32 * i);
+            words[i] = (words[i] ^ 0xaaaaaaaaaaaaaaaaULL) & lowBits(2 * bases);
+        }
+        return TwoBitKmer(words.data(), k);
     }
     //! Create k-mer string from 2bit representation
     std::string toString() const {
@@ -109,6 +151,21 @@ public:
 protected:
     friend struct TwoBitKmerHash<TwoBitKmerData>;
 
+    //! Mask of the lowest \c bits bits
+    static uint64_t lowBits(size_t bits) { return (bits >= 64) ? ~uint64_t{0} : ((uint64_t{1} << bits) - 1); }
+    //! Packed word \c i without any size information, i.e. only the bases
+    uint64_t packedWord(size_t i) const {
+        auto k = length();
+        auto bases = (32 * i >= k) ? 0 : std::min<size_t>(32, k - 32 * i);
+        return bitset_.word(i) & lowBits(2 * bases);
+    }
+    //! Reverse the order of the 32 two bit fields in \c x
+    static uint64_t reverseTwoBitFields(uint64_t x) {
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+        return __builtin_bswap64(x);
+    }
+
     //! Amount of bits to shift a single \c std::bitset<64> to get 7*(0000) 00xx where xx are the resp. bits for the base at \c position
     size_t bitsetShift(size_t position) const {
         /* base sequence in bitvector from right to left, i.e. '... 3322 1100'
@@ -190,6 +247,9 @@ public:
         sizeBits >>= 58;
         return sizeBits.to_ullong();
     }
+    //! Packed bases including the size bits
+    uint64_t word(size_t) const { return bitset_.to_ullong(); }
+    static constexpr size_t wordCount() { return 1; }
 private:
     std::bitset<64> bitset_;
 };
@@ -229,6 +289,9 @@ public:
         sizeBits >>= 58;
         return sizeBits.to_ullong();
     }
+    //! Packed bases, word 1 includes the size bits
+    uint64_t word(size_t i) const { return (i == 0) ? bitset1_.to_ullong() : bitset2_.to_ullong(); }
+    static constexpr size_t wordCount() { return 2; }
 private:
     std::bitset<64> bitset1_;   // bases 1 - 32
     std::bitset<64> bitset2_;   // bases 33 - 61 + size info
@@ -236,14 +299,48 @@ private:
 
 
 
-//! Can hold an arbitrary long k-mer, use only for k > 61
+//! Can hold up to (32*N - 4)-mers in N inline words (avoid heap allocation of TwoBitKmerDataLong)
+template <size_t N>
+class TwoBitKmerDataFixed {
+public:
+    //! Largest k that fits, the size is stored in the upper 8 bits of the last word
+    static constexpr size_t maxSize = 32 * N - 4;
+
+    TwoBitKmerDataFixed(size_t size)
+        : bitsets_{} {
+        if (size > maxSize) { throw std::runtime_error("[ERROR] -- TwoBitKmerDataFixed -- k too large for " + std::to_string(N) + " words"); }
+        auto sizeBits = std::bitset<64>{size};  // 0000 0000 .... xxxx xxxx
+        sizeBits <<= 56;                        // xxxx xxxx .... 0000 0000
+        bitsets_[N - 1] |= sizeBits;
+    }
+    std::bitset<64> & bitset(size_t position) { return bitsets_[position / 32]; }
+    std::bitset<64> const & bitsetRO(size_t position) const { return bitsets_[position / 32]; }
+    size_t objectSize() const {
+        return sizeof(bitsets_);
+    }
+    bool operator==(TwoBitKmerDataFixed const & rhs) const { return bitsets_ == rhs.bitsets_; }
+    size_t size() const {
+        auto sizeBits = bitsets_[N - 1];
+        sizeBits >>= 56;
+        return sizeBits.to_ullong();
+    }
+    //! Packed bases, word N-1 includes the size bits
+    uint64_t word(size_t i) const { return bitsets_[i].to_ullong(); }
+    static constexpr size_t wordCount() { return N; }
+private:
+    std::array<std::bitset<64>, N> bitsets_;
+};
+
+
+
+//! Can hold an arbitrary long k-mer, use only for k > 124
 class TwoBitKmerDataLong {
 public:
     TwoBitKmerDataLong(size_t size)
         : size_{size},
           // init bitset_ vector with enough bitsets to fit kmer
           bitsetVector_(static_cast<size_t>(std::ceil(static_cast<double>(size)/32.))) {
-         if (size <= 61) { std::cerr << "[WARNING] -- TwoBitKmerLong -- You should use TwoBitKmerMedium or TwoBitKmerShort for k <= 61" << std::endl; }
+         if (size <= TwoBitKmerDataFixed<4>::maxSize) { std::cerr << "[WARNING] -- TwoBitKmerLong -- You should use TwoBitKmerDataFixed, TwoBitKmerMedium or TwoBitKmerShort for k <= " << TwoBitKmerDataFixed<4>::maxSize << std::endl; }
     }
     std::bitset<64> & bitset(size_t position) {
         return bitsetVector_.at(bitsetIndex(position));
@@ -259,6 +356,8 @@ public:
     size_t size() const {
         return size_;
     }
+    uint64_t word(size_t i) const { return bitsetVector_[i].to_ullong(); }
+    size_t wordCount() const { return bitsetVector_.size(); }
 private:
     //! Index of bitset that holds the resp. bits for the base at \c position
     size_t bitsetIndex(size_t position) const { return position/32; }
@@ -270,11 +369,14 @@ private:
 
 
 //! Computes hash value of a TwoBitKmer object
+/*! Mixes the packed words directly, the k-mer is never decoded */
 template <typename TwoBitKmerData>
 struct TwoBitKmerHash {
     size_t operator()(TwoBitKmer<TwoBitKmerData> const & tbk) const {
-        std::hash<std::string> stringhash;
-        auto hashValue = stringhash(tbk.toString());
+        uint64_t hashValue = tbk.length();
+        for (size_t i = 0; i < tbk.bitset_.wordCount(); ++i) {
+            hashValue = mixHash64(hashValue ^ tbk.bitset_.word(i));
+        }
         return hashValue;
     }
 };
@@ -308,12 +410,8 @@ template<typename TwoBitKmerData>
 struct TwoBitKmerRCIncludingEqual {
     bool operator()(TwoBitKmer<TwoBitKmerData> const & lhs,
                     TwoBitKmer<TwoBitKmerData> const & rhs) const {
-        auto lhsRC = lhs.reverseComplement();
-        auto rhsRC = rhs.reverseComplement();
-        return lhs == rhs
-                || lhsRC == rhs
-                || lhs == rhsRC     // I think the last two checks are unneccessary...
-                || lhsRC == rhsRC;
+        // lhs == rhsRC and lhsRC == rhsRC are equivalent to the two checks below
+        return lhs == rhs || lhs.reverseComplement() == rhs;
     }
 };
 
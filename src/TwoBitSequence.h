@@ -0,0 +1,282 @@
+#ifndef TWOBITSEQUENCE_H
+#define TWOBITSEQUENCE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+
+//! Nucleotide sequence stored with two bits per base
+/*! Bases are encoded like in TwoBitKmer (A = 0, C = 1, T = 2, G = 3), 32 bases per 64 bit word,
+ * the first base of a word in its least significant bits. Characters that are not A, C, G or T
+ * (N, IUPAC codes, ...) are stored as runs in a sorted exception list and encoded as 'A' in the
+ * packed words. Lowercase (soft-masked) a, c, g and t are packed normally and their runs are
+ * stored in a second sorted interval list, so the original sequence can be fully restored.
+ *
+ * Random (artificial) sequences are stored virtually as length and seed, their packed words
+ * are generated on demand by a counter based random number generator. */
+class TwoBitSequence {
+public:
+    //! Run of identical non-ACGT characters
+    struct ExceptionRun {
+        size_t begin;
+        size_t length;
+        char character;
+        bool operator==(ExceptionRun const & rhs) const {
+            return begin == rhs.begin && length == rhs.length && character == rhs.character;
+        }
+    };
+    //! Run of soft-masked (lowercase) bases
+    struct SoftmaskRun {
+        size_t begin;
+        size_t length;
+        bool operator==(SoftmaskRun const & rhs) const {
+            return begin == rhs.begin && length == rhs.length;
+        }
+    };
+
+    //! c'tor (1)
+    /*! \details Creates an empty sequence */
+    TwoBitSequence()
+        : exceptions_{}, externalOwner_{}, externalWords_{nullptr},
+          length_{0}, random_{false}, randomSeed_{0}, softmasked_{}, words_{} {}
+    //! c'tor (2)
+    /*! \param sequence Sequence string to pack
+     *
+     * \details Creates the packed representation of \c sequence */
+    TwoBitSequence(std::string const & sequence) : TwoBitSequence() {
+        reserve(sequence.size());
+        append(sequence.data(), sequence.size());
+    }
+    //! c'tor (3)
+    /*! \param length Number of bases
+     * \param words Packed bases, stored elsewhere (e.g. in a memory mapped file)
+     * \param owner Keeps the memory behind \c words alive
+     * \param exceptions Sorted runs of non-ACGT characters
+     * \param softmasked Sorted runs of lowercase bases
+     *
+     * \details Uses \c words in place without copying, the sequence is copied to owned storage only if it is extended */
+    TwoBitSequence(size_t length, uint64_t const * words, std::shared_ptr<void const> owner,
+                   std::vector<ExceptionRun> exceptions, std::vector<SoftmaskRun> softmasked)
+        : exceptions_{std::move(exceptions)}, externalOwner_{owner}, externalWords_{words},
+          length_{length}, random_{false}, randomSeed_{0}, softmasked_{std::move(softmasked)}, words_{} {}
+    //! Copies share external storage, if any
+    TwoBitSequence(TwoBitSequence const &) = default;
+    TwoBitSequence(TwoBitSequence &&) = default;
+    TwoBitSequence & operator=(TwoBitSequence const &) = default;
+    TwoBitSequence & operator=(TwoBitSequence &&) = default;
+    //! Factory function to create a random ACGT sequence of length \c length
+    /*! The sequence is not materialized, equal \c seed always yields the same sequence */
+    static TwoBitSequence random(size_t length, uint64_t seed) {
+        TwoBitSequence sequence;
+        sequence.length_ = length;
+        sequence.random_ = true;
+        sequence.randomSeed_ = seed;
+        return sequence;
+    }
+    //! Append \c length characters from \c data to the sequence
+    void append(char const * data, size_t length) {
+        materialize();
+        auto& table = characterClasses();
+        for (size_t i = 0; i < length; ++i) {
+            auto c = data[i];
+            auto characterClass = table[static_cast<unsigned char>(c)];
+            uint64_t code = 0;
+            if (characterClass == exceptionClass_) {
+                if (exceptions_.size() > 0
+                        && exceptions_.back().character == c
+                        && exceptions_.back().begin + exceptions_.back().length == length_) {
+                    ++exceptions_.back().length;
+                } else {
+                    exceptions_.push_back(ExceptionRun{length_, 1, c});
+                }
+            } else {
+                code = (static_cast<uint64_t>(c) >> 1) & 3;
+                if (characterClass == softmaskClass_) {
+                    if (softmasked_.size() > 0 && softmasked_.back().begin + softmasked_.back().length == length_) {
+                        ++softmasked_.back().length;
+                    } else {
+                        softmasked_.push_back(SoftmaskRun{length_, 1});
+                    }
+                }
+            }
+            if (length_ % 32 == 0) { words_.emplace_back(0); }
+            words_.back() |= (code << (2 * (length_ % 32)));
+            ++length_;
+        }
+    }
+    //! Append a string to the sequence
+    void append(std::string const & extension) { append(extension.data(), extension.size()); }
+    //! Append another packed sequence
+    void append(TwoBitSequence const & extension) { append(extension.toString()); }
+    //! Return the character at \c position
+    char at(size_t position) const { return window(position, 1).at(0); }
+    //! Return the two bit code of the base at \c position, non-ACGT positions return 0
+    uint8_t code(size_t position) const {
+        return static_cast<uint8_t>((word(position / 32) >> (2 * (position % 32))) & 3);
+    }
+    //! Getter for member \c exceptions_
+    auto const & exceptions() const { return exceptions_; }
+    //! Call \c function(begin, end) on each maximal run of positions that hold uppercase A, C, G or T
+    template <typename F>
+    void forEachUnmaskedACGTRun(F function) const {
+        size_t begin = 0;
+        auto ex = exceptions_.begin();
+        auto sm = softmasked_.begin();
+        while (ex != exceptions_.end() || sm != softmasked_.end()) {
+            // next masked run is the one that starts first
+            size_t maskBegin, maskEnd;
+            if (sm == softmasked_.end() || (ex != exceptions_.end() && ex->begin < sm->begin)) {
+                maskBegin = ex->begin;
+                maskEnd = ex->begin + ex->length;
+                ++ex;
+            } else {
+                maskBegin = sm->begin;
+                maskEnd = sm->begin + sm->length;
+                ++sm;
+            }
+            if (maskBegin > begin) { function(begin, maskBegin); }
+            begin = maskEnd;
+        }
+        if (length_ > begin) { function(begin, length_); }
+    }
+    //! Getter for member \c random_
+    auto isRandom() const { return random_; }
+    //! Store the packed words in this object, i.e. generate the words of a random sequence or copy externally stored words
+    /*! Afterwards, \c word() reads \c words_ directly. No effect if the sequence is already materialized */
+    void materialize() {
+        if (externalWords_ || random_) { detach(); }
+    }
+    //! Calculate memory consumption of this object in bytes
+    size_t objectSize() const {
+        return sizeof(*this)
+                + words_.capacity() * sizeof(uint64_t)
+                + exceptions_.capacity() * sizeof(ExceptionRun)
+                + softmasked_.capacity() * sizeof(SoftmaskRun);
+    }
+    bool operator==(TwoBitSequence const & rhs) const {
+        if (length_ != rhs.length_ || exceptions_ != rhs.exceptions_ || softmasked_ != rhs.softmasked_) { return false; }
+        if (random_ && rhs.random_) { return randomSeed_ == rhs.randomSeed_; }
+        for (size_t i = 0; i < wordCount(); ++i) {
+            if (word(i) != rhs.word(i)) { return false; }
+        }
+        return true;
+    }
+    //! Getter for member \c randomSeed_, only meaningful if \c isRandom()
+    auto randomSeed() const { return randomSeed_; }
+    //! Pre-allocate storage for a sequence of \c length bases
+    void reserve(size_t length) { words_.reserve((length + 31) / 32); }
+    //! Return the sequence length
+    size_t size() const { return length_; }
+    //! Getter for member \c softmasked_
+    auto const & softmasked() const { return softmasked_; }
+    //! Restore the complete sequence string
+    std::string toString() const { return window(0, length_); }
+    //! Restore the substring of length \c length starting at \c position
+    /*! Like \c std::string::substr(), \c length is truncated at the end of the sequence */
+    std::string window(size_t position, size_t length) const {
+        if (position > length_) { throw std::out_of_range("[ERROR] -- TwoBitSequence::window -- Position out of range"); }
+        length = std::min(length, length_ - position);
+        std::string result(length, 'A');
+        static constexpr std::array<char, 4> bases{'A', 'C', 'T', 'G'};
+        for (size_t i = 0; i < length;) {     // decode word by word
+            auto pos = position + i;
+            auto packed = word(pos / 32) >> (2 * (pos % 32));
+            auto n = std::min<size_t>(32 - (pos % 32), length - i);
+            for (size_t j = 0; j < n; ++j, packed >>= 2) { result[i + j] = bases[packed & 3]; }
+            i += n;
+        }
+        auto end = position + length;
+        for (auto it = firstOverlapping(softmasked_, position); it != softmasked_.end() && it->begin < end; ++it) {
+            for (auto i = std::max(it->begin, position); i < std::min(it->begin + it->length, end); ++i) {
+                result[i - position] = static_cast<char>(result[i - position] | 0x20);  // to lowercase
+            }
+        }
+        for (auto it = firstOverlapping(exceptions_, position); it != exceptions_.end() && it->begin < end; ++it) {
+            for (auto i = std::max(it->begin, position); i < std::min(it->begin + it->length, end); ++i) {
+                result[i - position] = it->character;
+            }
+        }
+        return result;
+    }
+    //! Return the packed word \c i, holding the bases [32*i, 32*i+32)
+    uint64_t word(size_t i) const {
+        if (externalWords_) { return externalWords_[i]; }
+        if (random_) { return randomWord(i); }
+        return words_[i];
+    }
+    //! Number of packed words
+    size_t wordCount() const { return (length_ + 31) / 32; }
+
+private:
+    //! Copy externally stored or generated words into \c words_
+    void detach() {
+        std::vector<uint64_t> words(wordCount());
+        for (size_t i = 0; i < words.size(); ++i) { words[i] = word(i); }
+        words_ = std::move(words);
+        externalWords_ = nullptr;
+        externalOwner_.reset();
+        random_ = false;
+    }
+    //! Generate packed word \c i of a random sequence
+    /*! SplitMix64 output for counter \c i, i.e. each word can be created independently.
+     * Bases behind the end of the sequence are set to zero like in materialized sequences */
+    uint64_t randomWord(size_t i) const {
+        auto z = randomSeed_ + (static_cast<uint64_t>(i) + 1) * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= (z >> 31);
+        auto remaining = length_ - 32 * i;
+        return (remaining >= 32) ? z : (z & ((1ULL << (2 * remaining)) - 1));
+    }
+    //! Return iterator to the first run in \c runs that ends after \c position
+    template <typename RunVector>
+    static typename RunVector::const_iterator firstOverlapping(RunVector const & runs, size_t position) {
+        auto it = std::upper_bound(runs.begin(), runs.end(), position,
+                                   [](size_t pos, auto const & run) { return pos < run.begin; });
+        if (it != runs.begin() && std::prev(it)->begin + std::prev(it)->length > position) { --it; }
+        return it;
+    }
+    //! Lookup table that assigns each character one of the classes below
+    static std::array<uint8_t, 256> const & characterClasses() {
+        static std::array<uint8_t, 256> const table = [](){
+            std::array<uint8_t, 256> t;
+            t.fill(exceptionClass_);
+            for (char c : std::string("ACGT")) { t[static_cast<unsigned char>(c)] = baseClass_; }
+            for (char c : std::string("acgt")) { t[static_cast<unsigned char>(c)] = softmaskClass_; }
+            return t;
+        }();
+        return table;
+    }
+
+    static constexpr uint8_t baseClass_ = 0;
+    static constexpr uint8_t softmaskClass_ = 1;
+    static constexpr uint8_t exceptionClass_ = 2;
+
+    //! Sorted runs of non-ACGT characters
+    std::vector<ExceptionRun> exceptions_;
+    //! Keeps external storage of packed words alive, if any
+    std::shared_ptr<void const> externalOwner_;
+    //! Packed words that are not owned by this object or \c nullptr
+    uint64_t const * externalWords_;
+    //! Number of bases
+    size_t length_;
+    //! Bases are generated from \c randomSeed_
+    bool random_;
+    //! Seed of a random sequence
+    uint64_t randomSeed_;
+    //! Sorted runs of lowercase bases
+    std::vector<SoftmaskRun> softmasked_;
+    //! Packed bases, unused if \c externalWords_ is set
+    std::vector<uint64_t> words_;
+};
+
+#endif // TWOBITSEQUENCE_H
@@ -0,0 +1,57 @@
+#ifndef WINDOWMINIMIZERS_H
+#define WINDOWMINIMIZERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+
+//! Streaming selection of the smallest key in each window of \c w consecutive keys (robust winnowing)
+/*! The candidates are kept in a deque with increasing keys, so each key is pushed and popped at most once and
+ * the deque never holds more than \c w keys. On ties, the leftmost position wins. Each minimizer is reported once,
+ * when the first window that selects it is complete, i.e. at most w - 1 keys after its own key. If a run has fewer
+ * than \c w keys, \c finish() reports its smallest key, so each non-empty run keeps at least one position and
+ * no \c w consecutive positions are left unselected */
+class WindowMinimizerStream {
+public:
+    //! Returned if no position is selected
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    //! c'tor
+    /*! \param w Window size, 1 selects all positions */
+    WindowMinimizerStream(size_t w) : candidates_{}, last_{npos}, size_{0}, w_{w} {}
+
+    //! Start a new run
+    void reset() {
+        candidates_.clear();
+        last_ = npos;
+        size_ = 0;
+    }
+    //! Add the key of the next position of the run, positions count from 0 since \c reset()
+    /*! Returns the position that is selected by the window ending at this key, \c npos if there is no
+     * complete window yet or its minimizer was already reported */
+    size_t push(uint64_t key) {
+        while (!candidates_.empty() && candidates_.back().second > key) { candidates_.pop_back(); }
+        candidates_.emplace_back(size_, key);
+        if (candidates_.front().first + w_ <= size_) { candidates_.pop_front(); }  // left the window [size_+1-w, size_]
+        ++size_;
+        if (size_ < w_ || candidates_.front().first == last_) { return npos; }
+        last_ = candidates_.front().first;
+        return last_;
+    }
+    //! End the run, returns the smallest key of a run with fewer than \c w keys, \c npos otherwise
+    size_t finish() const { return (size_ > 0 && size_ < w_) ? candidates_.front().first : npos; }
+
+private:
+    //! Positions and keys of the candidates, keys increase from front to back
+    std::deque<std::pair<size_t, uint64_t>> candidates_;
+    //! Last reported position
+    size_t last_;
+    //! Number of keys since \c reset()
+    size_t size_;
+    //! Window size
+    size_t w_;
+};
+
+#endif // WINDOWMINIMIZERS_H
@@ -0,0 +1,89 @@
+/* Benchmark of the spaced seed extraction kernels
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Rolls a random sequence through a RollingKmerWindow and gathers the optimal spaced seed of each
+ * weight (see optimalSpacedSeeds.h) from every window, once per window with SpacedSeedGather::gather()
+ * and blockwise with each SpacedSeedGather::gatherBlock() kernel this CPU supports. Reports
+ * single threaded throughput in million bases per second, i.e. per core.
+ *
+ * Usage: benchmarkSeedExtraction [sequence length in Mbp, default 16]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "optimalSpacedSeeds.h"
+#include "RollingKmerWindow.h"
+#include "SpacedSeedGather.h"
+#include "TwoBitSequence.h"
+
+
+
+//! Run \c function on the complete sequence, return million bases per second
+template <typename F>
+double measure(TwoBitSequence const & sequence, size_t span, F function) {
+    auto start = std::chrono::steady_clock::now();
+    RollingKmerWindow window(span);
+    uint64_t packed = 0;
+    for (size_t p = 0; p < sequence.size(); ++p, packed >>= 2) {
+        if (p % 32 == 0) { packed = sequence.word(p / 32); }
+        window.push(packed & 3);
+        if (window.full()) { function(window); }
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(sequence.size()) / seconds.count() / 1e6;
+}
+
+
+
+//! Main
+int main(int argc, char * argv[]) {
+    size_t megabases = (argc > 1) ? std::stoul(argv[1]) : 16;
+    auto sequence = TwoBitSequence::random(megabases * 1000000, 42);
+    sequence.materialize();     // generating the words is not part of the benchmark
+    std::vector<SpacedSeedGather::Kernel> kernels;
+    for (auto kernel : {SpacedSeedGather::Kernel::scalar, SpacedSeedGather::Kernel::avx2, SpacedSeedGather::Kernel::bmi2}) {
+        if (SpacedSeedGather::kernelSupported(kernel)) { kernels.emplace_back(kernel); }
+    }
+    std::cout << "Sequence length: " << sequence.size() << " bp, default kernel: "
+              << SpacedSeedGather::kernelName(SpacedSeedGather::bestKernel()) << std::endl;
+    std::cout << "weight\tspan\tkernel\tMbp/s\tchecksum" << std::endl;
+    for (size_t weight = 3; weight <= 31; ++weight) {
+        auto mask = optimalSpacedSeeds(weight).front();
+        SpacedSeedGather gather(mask);
+        std::vector<uint64_t> seed(gather.wordCount());
+        // reference: one window at a time
+        uint64_t checksum = 0;
+        auto throughput = measure(sequence, mask.span(), [&](RollingKmerWindow const & window) {
+            gather.gather(window.forward(), seed.data());
+            checksum += seed[0];
+        });
+        std::cout << weight << "\t" << mask.span() << "\tgather\t" << std::fixed << std::setprecision(1)
+                  << throughput << "\t" << checksum << std::endl;
+        if (!gather.blockCompatible()) { continue; }
+        // blockwise
+        constexpr size_t blockSize = 256;
+        std::vector<uint64_t> lo(blockSize), hi(blockSize), seeds(blockSize);
+        for (auto kernel : kernels) {
+            checksum = 0;
+            size_t n = 0;
+            auto flush = [&]() {
+                gather.gatherBlock(lo.data(), hi.data(), n, seeds.data(), kernel);
+                for (size_t j = 0; j < n; ++j) { checksum += seeds[j]; }
+                n = 0;
+            };
+            throughput = measure(sequence, mask.span(), [&](RollingKmerWindow const & window) {
+                lo[n] = window.forward()[0];
+                hi[n] = (window.forward().size() > 1) ? window.forward()[1] : 0;
+                if (++n == blockSize) { flush(); }
+            });
+            flush();
+            std::cout << weight << "\t" << mask.span() << "\t" << SpacedSeedGather::kernelName(kernel) << "\t"
+                      << throughput << "\t" << checksum << std::endl;
+        }
+    }
+    return 0;
+}
@@ -57,11 +57,15 @@ int main(int argc, char * argv[]) {
     std::cout << mm << std::endl << std::endl;
     std::cout << "Starting Program" << std::endl;
 
-    // Run pipeline
+    // Run pipeline, seed types with a fixed number of inline words let the compiler unroll all k-mer loops
     if (config->weight() <= 29) {
         SeedFinder<TwoBitKmerDataShort>(config).run();
     } else if (config->weight() <= 61) {
         SeedFinder<TwoBitKmerDataMedium>(config).run();
+    } else if (config->weight() <= TwoBitKmerDataFixed<3>::maxSize) {
+        SeedFinder<TwoBitKmerDataFixed<3>>(config).run();
+    } else if (config->weight() <= TwoBitKmerDataFixed<4>::maxSize) {
+        SeedFinder<TwoBitKmerDataFixed<4>>(config).run();
     } else {
         SeedFinder<TwoBitKmerDataLong>(config).run();
     }